@@ -0,0 +1,497 @@
+// times the queries on generated meshes of increasing size and writes one JSON object per
+// line, so that the results of two builds can be compared. run with --help for the options
+#include "MeshPlaneIntersect.hpp"
+#include "MeshCacheFile.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+typedef MeshPlaneIntersect<double, int> Intersector;
+
+// every allocation goes through here so that each query can report what it allocated
+static std::atomic<size_t> allocationCount(0);
+static std::atomic<size_t> allocationBytes(0);
+
+static void* Allocate(const size_t size) {
+	++allocationCount;
+	allocationBytes += size;
+	if (void* memory = std::malloc(size ? size : 1)) {
+		return memory;
+	}
+	throw std::bad_alloc();
+}
+
+// the array forms are replaced too, so every new is paired with a delete of its own kind
+void* operator new(size_t size) {
+	return Allocate(size);
+}
+
+void* operator new[](size_t size) {
+	return Allocate(size);
+}
+
+void operator delete(void* memory) noexcept {
+	std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+	std::free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+	std::free(memory);
+}
+
+static const double pi(3.14159265358979323846);
+
+struct TestMesh {
+	std::string name;
+	std::vector<Intersector::Vec3D> vertices;
+	std::vector<Intersector::Face> faces;
+};
+
+// a quad grid of columns by rows cells, wrapping around in either direction when asked,
+// with two faces per cell. cells for which keep is false are left out
+static void GridFaces(const int columns, const int rows, const bool wrapColumns,
+	const bool wrapRows, const int firstVertex, const std::function<bool(int, int)>& keep,
+	std::vector<Intersector::Face>& faces) {
+	const int rowSize(wrapColumns ? columns : columns + 1);
+	const int rowCount(wrapRows ? rows : rows + 1);
+	for (int row(0); row < rows; ++row) {
+		for (int column(0); column < columns; ++column) {
+			if (!keep(column, row)) {
+				continue;
+			}
+			const int nextColumn((column + 1) % rowSize);
+			const int nextRow((row + 1) % rowCount);
+			const int a(firstVertex + row * rowSize + column);
+			const int b(firstVertex + row * rowSize + nextColumn);
+			const int c(firstVertex + nextRow * rowSize + nextColumn);
+			const int d(firstVertex + nextRow * rowSize + column);
+			faces.push_back({ a, b, c });
+			faces.push_back({ a, c, d });
+		}
+	}
+}
+
+static bool KeepAll(int, int) {
+	return true;
+}
+
+// a sphere of the given radius with segments around and rings from pole to pole
+static void AddSphere(const Intersector::Vec3D& centre, const double radius, const int segments,
+	const int rings, TestMesh& mesh) {
+	const int firstVertex(static_cast<int>(mesh.vertices.size()));
+	mesh.vertices.push_back({ centre[0], centre[1], centre[2] - radius });
+	for (int ring(1); ring < rings; ++ring) {
+		const double polar(pi * ring / rings);
+		for (int segment(0); segment < segments; ++segment) {
+			const double azimuth(2 * pi * segment / segments);
+			mesh.vertices.push_back({ centre[0] + radius * std::sin(polar) * std::cos(azimuth),
+				centre[1] + radius * std::sin(polar) * std::sin(azimuth),
+				centre[2] - radius * std::cos(polar) });
+		}
+	}
+	const int top(static_cast<int>(mesh.vertices.size()));
+	mesh.vertices.push_back({ centre[0], centre[1], centre[2] + radius });
+	const int lastRing(top - segments);
+	for (int segment(0); segment < segments; ++segment) {
+		const int next((segment + 1) % segments);
+		mesh.faces.push_back({ firstVertex, firstVertex + 1 + next, firstVertex + 1 + segment });
+		mesh.faces.push_back({ top, lastRing + segment, lastRing + next });
+	}
+	GridFaces(segments, rings - 2, true, false, firstVertex + 1, KeepAll, mesh.faces);
+}
+
+static TestMesh Sphere(const size_t faceCount) {
+	// 2 * segments * (rings - 1) faces, with twice as many segments as rings
+	const int rings(std::max(3, static_cast<int>(std::sqrt(faceCount / 4.0))));
+	TestMesh mesh;
+	mesh.name = "sphere";
+	AddSphere({ 0,0,0 }, 1, 2 * rings, rings, mesh);
+	return mesh;
+}
+
+static TestMesh Torus(const size_t faceCount) {
+	const int minor(std::max(3, static_cast<int>(std::sqrt(faceCount / 8.0))));
+	const int major(4 * minor);
+	TestMesh mesh;
+	mesh.name = "torus";
+	for (int i(0); i < minor; ++i) {
+		const double tube(2 * pi * i / minor);
+		for (int j(0); j < major; ++j) {
+			const double around(2 * pi * j / major);
+			const double radius(1 + 0.3 * std::cos(tube));
+			mesh.vertices.push_back({ radius * std::cos(around), radius * std::sin(around),
+				0.3 * std::sin(tube) });
+		}
+	}
+	GridFaces(major, minor, true, true, 0, KeepAll, mesh.faces);
+	return mesh;
+}
+
+// a height field with several octaves of repeatable noise, and a grid with square holes
+static void AddTerrain(const int size, const std::function<bool(int, int)>& keep,
+	TestMesh& mesh) {
+	for (int row(0); row <= size; ++row) {
+		for (int column(0); column <= size; ++column) {
+			const double x(double(column) / size), y(double(row) / size);
+			double height(0), scale(0.1);
+			for (int octave(1); octave <= 16; octave *= 2) {
+				height += scale * std::sin(7.1 * octave * x + 1.3 * octave) *
+					std::cos(5.3 * octave * y + 0.7 * octave);
+				scale *= 0.5;
+			}
+			mesh.vertices.push_back({ x, y, height });
+		}
+	}
+	GridFaces(size, size, false, false, 0, keep, mesh.faces);
+}
+
+static TestMesh Terrain(const size_t faceCount) {
+	TestMesh mesh;
+	mesh.name = "terrain";
+	AddTerrain(std::max(2, static_cast<int>(std::sqrt(faceCount / 2.0))), KeepAll, mesh);
+	return mesh;
+}
+
+static TestMesh Holes(const size_t faceCount) {
+	// one cell in every 4 by 4 block is left out
+	TestMesh mesh;
+	mesh.name = "holes";
+	AddTerrain(std::max(4, static_cast<int>(std::sqrt(faceCount / 1.875))),
+		[](int column, int row) { return column % 4 != 1 || row % 4 != 1; }, mesh);
+	return mesh;
+}
+
+static TestMesh Shells(const size_t faceCount) {
+	// a grid of separate spheres of 112 faces each
+	const int segments(8), rings(8), sphereFaces(2 * segments * (rings - 1));
+	const int across(std::max(1, static_cast<int>(std::cbrt(double(faceCount) / sphereFaces))));
+	TestMesh mesh;
+	mesh.name = "shells";
+	for (int i(0); i < across; ++i) {
+		for (int j(0); j < across; ++j) {
+			for (int k(0); k < across; ++k) {
+				AddSphere({ double(i), double(j), double(k) }, 0.4, segments, rings, mesh);
+			}
+		}
+	}
+	return mesh;
+}
+
+struct Options {
+	size_t minFaces = 1000;
+	size_t maxFaces = 1000000;
+	size_t threadCount = 1;
+	int repeats = 5;
+	size_t sliceCount = 100;
+	std::string only;
+};
+
+struct Measurement {
+	double seconds = 0;
+	size_t allocations = 0;
+	size_t allocatedBytes = 0;
+	size_t contours = 0;
+};
+
+// runs query repeats times after one untimed run and keeps the median time. query returns
+// the number of contours it found
+static Measurement Measure(const int repeats, const std::function<size_t()>& query) {
+	Measurement measurement;
+	std::vector<double> times;
+	query();
+	for (int i(0); i < repeats; ++i) {
+		const size_t count(allocationCount), bytes(allocationBytes);
+		const auto start(std::chrono::steady_clock::now());
+		measurement.contours = query();
+		const auto end(std::chrono::steady_clock::now());
+		measurement.allocations = allocationCount - count;
+		measurement.allocatedBytes = allocationBytes - bytes;
+		times.push_back(std::chrono::duration<double>(end - start).count());
+	}
+	std::sort(times.begin(), times.end());
+	measurement.seconds = times[times.size() / 2];
+	return measurement;
+}
+
+static size_t PeakMemory() {
+#ifdef __linux__
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#else
+	return 0;
+#endif
+}
+
+// faceVisits is the number of faces the query looks at, which is more than the mesh has
+// for queries with several planes
+static void Report(const TestMesh& mesh, const std::string& query, const Options& options,
+	const size_t faceVisits, const Measurement& measurement) {
+	std::printf("{\"mesh\":\"%s\",\"faces\":%zu,\"vertices\":%zu,\"query\":\"%s\","
+		"\"threads\":%zu,\"seconds\":%.9g,\"facesPerSecond\":%.6g,\"contours\":%zu,"
+		"\"contoursPerSecond\":%.6g,\"allocations\":%zu,\"allocatedBytes\":%zu,"
+		"\"peakMemoryBytes\":%zu}\n",
+		mesh.name.c_str(), mesh.faces.size(), mesh.vertices.size(), query.c_str(),
+		options.threadCount, measurement.seconds, faceVisits / measurement.seconds,
+		measurement.contours, measurement.contours / measurement.seconds,
+		measurement.allocations, measurement.allocatedBytes, PeakMemory());
+	std::fflush(stdout);
+}
+
+#ifdef MESH_PLANE_INTERSECT_STATISTICS
+// the steps of one query, from the statistics recorded in its workspace
+static void ReportSteps(const TestMesh& mesh, const std::string& query,
+	const Intersector::Statistics& statistics) {
+	std::printf("{\"mesh\":\"%s\",\"faces\":%zu,\"query\":\"%s\",\"steps\":{"
+		"\"vertexOffsetSeconds\":%.9g,\"crossingFaceSeconds\":%.9g,\"edgePathSeconds\":%.9g,"
+		"\"freeEdgeSeconds\":%.9g,\"freeEdgePathSeconds\":%.9g,\"chainSeconds\":%.9g,"
+		"\"pathSeconds\":%.9g,\"crossingFaces\":%zu,\"edgePaths\":%zu,\"freeEdgePaths\":%zu,"
+		"\"chainedPaths\":%zu,\"chainProbes\":%zu,\"freeEdges\":%zu,\"workspaceBytes\":%zu}}\n",
+		mesh.name.c_str(), mesh.faces.size(), query.c_str(), statistics.vertexOffsetSeconds,
+		statistics.crossingFaceSeconds, statistics.edgePathSeconds, statistics.freeEdgeSeconds,
+		statistics.freeEdgePathSeconds, statistics.chainSeconds, statistics.pathSeconds,
+		statistics.crossingFaces, statistics.edgePaths, statistics.freeEdgePaths,
+		statistics.chainedPaths, statistics.chainProbes, statistics.freeEdges,
+		statistics.workspaceBytes);
+	std::fflush(stdout);
+}
+#endif
+
+static size_t CountPaths(const std::vector<std::vector<Intersector::Path3D>>& layers) {
+	size_t count(0);
+	for (const auto& layer : layers) {
+		count += layer.size();
+	}
+	return count;
+}
+
+static void Run(const TestMesh& testMesh, const Options& options) {
+	Intersector::Mesh mesh(testMesh.vertices, testMesh.faces);
+	const size_t faceCount(testMesh.faces.size());
+	const size_t threadCount(options.threadCount);
+	const int repeats(options.repeats);
+	// a slightly tilted plane a little below the middle of the mesh, away from any vertex
+	double low[3] = { 1e300, 1e300, 1e300 }, high[3] = { -1e300, -1e300, -1e300 };
+	for (const auto& vertex : testMesh.vertices) {
+		for (int i(0); i < 3; ++i) {
+			low[i] = std::min(low[i], vertex[i]);
+			high[i] = std::max(high[i], vertex[i]);
+		}
+	}
+	Intersector::Plane plane;
+	plane.normal = { 0.0123, 0.0371, 1 };
+	for (int i(0); i < 3; ++i) {
+		plane.origin[i] = low[i] + (high[i] - low[i]) * 0.37317;
+	}
+
+	Report(testMesh, "Intersect", options, faceCount, Measure(repeats, [&] {
+		return mesh.Intersect(plane, threadCount).size();
+	}));
+	Report(testMesh, "Clip", options, faceCount, Measure(repeats, [&] {
+		return mesh.Clip(plane, threadCount).size();
+	}));
+	// a thousandth of the height, about what a slicer would allow
+	const double tolerance((high[2] - low[2]) * 1e-3);
+	Report(testMesh, "IntersectSimplified", options, faceCount, Measure(repeats, [&] {
+		return mesh.Intersect(plane, threadCount, tolerance).size();
+	}));
+	Intersector::AxisPlane<2> axisPlane;
+	axisPlane.position = plane.origin[2];
+	Report(testMesh, "IntersectAxis", options, faceCount, Measure(repeats, [&] {
+		return mesh.Intersect(axisPlane, threadCount).size();
+	}));
+
+	Intersector::Mesh::Workspace workspace;
+	Intersector::FlatPaths flat;
+	Report(testMesh, "IntersectWorkspace", options, faceCount, Measure(repeats, [&] {
+		mesh.Intersect(plane, workspace, flat, threadCount);
+		return flat.isClosed.size();
+	}));
+	Intersector::SymbolicPaths symbolic;
+	Report(testMesh, "IntersectSymbolic", options, faceCount, Measure(repeats, [&] {
+		mesh.Intersect(plane, workspace, symbolic, threadCount);
+		return symbolic.isClosed.size();
+	}));
+	std::vector<Intersector::AreaProperties> loops;
+	Intersector::AreaProperties total;
+	Report(testMesh, "IntersectProperties", options, faceCount, Measure(repeats, [&] {
+		mesh.IntersectProperties(plane, workspace, loops, total, threadCount);
+		return loops.size();
+	}));
+	std::vector<Intersector::Polygon2D> polygons;
+	Report(testMesh, "IntersectPolygons", options, faceCount, Measure(repeats, [&] {
+		mesh.IntersectPolygons(plane, workspace, polygons, threadCount);
+		return polygons.size();
+	}));
+	Intersector::IndexedMesh above, below;
+	Report(testMesh, "Split", options, faceCount, Measure(repeats, [&] {
+		// the faces of the parts are counted in place of contours
+		mesh.Split(plane, workspace, above, below, true, threadCount);
+		return above.faces.size() + below.faces.size();
+	}));
+#ifdef MESH_PLANE_INTERSECT_STATISTICS
+	mesh.Intersect(plane, workspace, flat, threadCount);
+	ReportSteps(testMesh, "Intersect", workspace.GetStatistics());
+	mesh.Clip(plane, workspace, flat, threadCount);
+	ReportSteps(testMesh, "Clip", workspace.GetStatistics());
+#endif
+
+	// the slices and the section share a stack of planes across the height of the mesh
+	const Intersector::Vec3D normal{ 0, 0, 1 };
+	const double spacing((high[2] - low[2]) / options.sliceCount);
+	const double firstOffset(low[2] + spacing * 0.5137);
+	Report(testMesh, "Slice", options, faceCount * options.sliceCount, Measure(repeats, [&] {
+		return CountPaths(mesh.Slice(normal, firstOffset, spacing, options.sliceCount));
+	}));
+	Report(testMesh, "Section", options, faceCount * options.sliceCount, Measure(repeats, [&] {
+		Intersector::Mesh::Section section(mesh, normal);
+		std::vector<Intersector::Path3D> result;
+		size_t count(0);
+		for (size_t i(0); i < options.sliceCount; ++i) {
+			section.Intersect(firstOffset + spacing * i, result);
+			count += result.size();
+		}
+		return count;
+	}));
+	// radial planes around a vertical axis through the middle
+	std::vector<Intersector::Plane> radialPlanes(options.sliceCount);
+	for (size_t i(0); i < radialPlanes.size(); ++i) {
+		const double angle(pi * (i + 0.5137) / radialPlanes.size());
+		radialPlanes[i].origin = plane.origin;
+		radialPlanes[i].normal = { std::cos(angle), std::sin(angle), 0.0123 };
+	}
+	Report(testMesh, "IntersectPlanes", options, faceCount * options.sliceCount,
+		Measure(repeats, [&] {
+		return CountPaths(mesh.IntersectPlanes(radialPlanes, threadCount));
+	}));
+	Report(testMesh, "ClipPlanes", options, faceCount * options.sliceCount,
+		Measure(repeats, [&] {
+		return CountPaths(mesh.ClipPlanes(radialPlanes, threadCount));
+	}));
+
+	Intersector::Mesh prepared(testMesh.vertices, testMesh.faces);
+	const auto start(std::chrono::steady_clock::now());
+	prepared.BuildTopology();
+	prepared.BuildVertexArrays();
+	prepared.BuildFaceHierarchy();
+	Measurement build;
+	build.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	Report(testMesh, "Build", options, faceCount, build);
+	Report(testMesh, "IntersectPrepared", options, faceCount, Measure(repeats, [&] {
+		return prepared.Intersect(plane, threadCount).size();
+	}));
+
+	// the prepared mesh saved to a cache file, then mapped back in place of building it
+	const std::string cachePath("Benchmark.cache");
+	MeshCacheFile<double, int>::Write(cachePath, prepared);
+	{
+		const auto loadStart(std::chrono::steady_clock::now());
+		const MeshCacheFile<double, int> cache(cachePath);
+		Measurement load;
+		load.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+		Report(testMesh, "CacheLoad", options, faceCount, load);
+		Report(testMesh, "IntersectCached", options, faceCount, Measure(repeats, [&] {
+			return cache.GetMesh().Intersect(plane, threadCount).size();
+		}));
+	}
+	std::remove(cachePath.c_str());
+
+	// the same prepared queries with the vertices and faces in Morton order
+	std::vector<Intersector::Vec3D> reorderedVertices(testMesh.vertices);
+	std::vector<Intersector::Face> reorderedFaces(testMesh.faces);
+	std::vector<int> vertexOrder, faceOrder;
+	const auto reorderStart(std::chrono::steady_clock::now());
+	Intersector::Mesh::Reorder(reorderedVertices, reorderedFaces, vertexOrder, faceOrder, threadCount);
+	Measurement reorder;
+	reorder.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - reorderStart).count();
+	Report(testMesh, "Reorder", options, faceCount, reorder);
+	Intersector::Mesh reordered(reorderedVertices, reorderedFaces);
+	reordered.BuildTopology();
+	reordered.BuildVertexArrays();
+	reordered.BuildFaceHierarchy();
+	Report(testMesh, "IntersectReordered", options, faceCount, Measure(repeats, [&] {
+		return reordered.Intersect(plane, threadCount).size();
+	}));
+}
+
+static void PrintHelp() {
+	std::printf(
+		"usage: Benchmark [options]\n"
+		"  --min-faces N   smallest mesh size (1000)\n"
+		"  --max-faces N   largest mesh size, up to 50000000 (1000000)\n"
+		"  --threads N     threads per query (1)\n"
+		"  --repeats N     timed runs per query, the median is reported (5)\n"
+		"  --slices N      planes for Slice, Section and the radial planes (100)\n"
+		"  --mesh NAME     only sphere, torus, terrain, holes or shells\n"
+		"each result is written as a JSON object on its own line\n");
+}
+
+int main(int argc, char** argv) {
+	Options options;
+	for (int i(1); i < argc; ++i) {
+		const std::string option(argv[i]);
+		const char* value(i + 1 < argc ? argv[i + 1] : nullptr);
+		if (option == "--help" || !value) {
+			PrintHelp();
+			return option == "--help" ? 0 : 1;
+		}
+		if (option == "--min-faces") {
+			options.minFaces = std::strtoull(value, nullptr, 10);
+		}
+		else if (option == "--max-faces") {
+			options.maxFaces = std::strtoull(value, nullptr, 10);
+		}
+		else if (option == "--threads") {
+			options.threadCount = std::max<size_t>(1, std::strtoull(value, nullptr, 10));
+		}
+		else if (option == "--repeats") {
+			options.repeats = std::max(1, std::atoi(value));
+		}
+		else if (option == "--slices") {
+			options.sliceCount = std::max<size_t>(1, std::strtoull(value, nullptr, 10));
+		}
+		else if (option == "--mesh") {
+			options.only = value;
+		}
+		else {
+			PrintHelp();
+			return 1;
+		}
+		++i;
+	}
+	const std::vector<std::pair<std::string, std::function<TestMesh(size_t)>>> generators{
+		{ "sphere", Sphere }, { "torus", Torus }, { "terrain", Terrain },
+		{ "holes", Holes }, { "shells", Shells }
+	};
+	const size_t sizes[] = { 1000, 10000, 100000, 1000000, 10000000, 50000000 };
+	for (const auto& generator : generators) {
+		if (!options.only.empty() && options.only != generator.first) {
+			continue;
+		}
+		for (const size_t size : sizes) {
+			if (size >= options.minFaces && size <= options.maxFaces) {
+				Run(generator.second(size), options);
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <string>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// a read only view of a whole file, mapped into memory rather than read. throws
+// std::runtime_error if the file can't be opened or mapped
+class MappedFile {
+
+public:
+	explicit MappedFile(const std::string& path) {
+		Map(path);
+	}
+
+	~MappedFile() {
+		Unmap();
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const char* Data() const {
+		return data;
+	}
+
+	size_t Size() const {
+		return size;
+	}
+
+private:
+	const char* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+
+	void Map(const std::string& path) {
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL, nullptr);
+		LARGE_INTEGER fileSize;
+		if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize)) {
+			Unmap();
+			throw std::runtime_error("could not open " + path);
+		}
+		size = static_cast<size_t>(fileSize.QuadPart);
+		if (size == 0) {
+			return;
+		}
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		data = mapping ? static_cast<const char*>(
+			MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+		if (!data) {
+			Unmap();
+			throw std::runtime_error("could not map " + path);
+		}
+	}
+
+	void Unmap() {
+		if (data) {
+			UnmapViewOfFile(data);
+		}
+		if (mapping) {
+			CloseHandle(mapping);
+		}
+		if (file != INVALID_HANDLE_VALUE) {
+			CloseHandle(file);
+		}
+		data = nullptr;
+		mapping = nullptr;
+		file = INVALID_HANDLE_VALUE;
+	}
+#else
+	void Map(const std::string& path) {
+		const int file(open(path.c_str(), O_RDONLY));
+		struct stat status;
+		if (file < 0 || fstat(file, &status) != 0) {
+			if (file >= 0) {
+				close(file);
+			}
+			throw std::runtime_error("could not open " + path);
+		}
+		size = static_cast<size_t>(status.st_size);
+		if (size > 0) {
+			void* mapped(mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0));
+			data = mapped == MAP_FAILED ? nullptr : static_cast<const char*>(mapped);
+		}
+		close(file);
+		if (size > 0 && !data) {
+			throw std::runtime_error("could not map " + path);
+		}
+	}
+
+	void Unmap() {
+		if (data) {
+			munmap(const_cast<char*>(data), size);
+		}
+		data = nullptr;
+	}
+#endif
+};
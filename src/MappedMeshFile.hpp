@@ -0,0 +1,118 @@
+#pragma once
+#include "MeshPlaneIntersect.hpp"
+#include "MappedFile.hpp"
+#include <string>
+#include <stdexcept>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+
+// a mesh file that is memory mapped rather than read, so that meshes larger than memory
+// can be intersected with Mesh::IntersectStream. the layout, in the byte order of the
+// machine that wrote it, is
+//   char[8]                          "MPIMESH1"
+//   uint32                           sizeof(FloatType)
+//   uint32                           sizeof(IndexType)
+//   uint64                           vertex count
+//   uint64                           face count
+//   FloatType[3 * vertex count]      x, y and z of each vertex
+//   IndexType[3 * face count]        the three vertices of each face
+template <class FloatType, class IndexType>
+class MappedMeshFile {
+
+public:
+	typedef typename MeshPlaneIntersect<FloatType, IndexType>::Vec3D Vec3D;
+	typedef typename MeshPlaneIntersect<FloatType, IndexType>::Face Face;
+
+	// throws std::runtime_error if the file can't be mapped or isn't laid out as above
+	explicit MappedMeshFile(const std::string& path) :
+		file(path), data(file.Data()), size(file.Size()) {
+		ReadHeader();
+	}
+
+	size_t VertexCount() const {
+		return vertexCount;
+	}
+
+	size_t FaceCount() const {
+		return faceCount;
+	}
+
+	Vec3D ReadVertex(const size_t index) const {
+		Vec3D vertex;
+		std::memcpy(vertex.data(), data + vertexStart + index * vertexSize, vertexSize);
+		return vertex;
+	}
+
+	// throws std::runtime_error if a face has a vertex number out of range, which the
+	// header can't rule out
+	void ReadFaces(const size_t first, const size_t count, Face* faces) const {
+		for (size_t i(0); i < count; ++i) {
+			std::memcpy(faces[i].data(), data + faceStart + (first + i) * faceSize, faceSize);
+			for (const auto& vertex : faces[i]) {
+				// negative numbers wrap round to more than any count
+				if (static_cast<std::uint64_t>(vertex) >= vertexCount) {
+					throw std::runtime_error("mesh file face has a vertex out of range");
+				}
+			}
+		}
+	}
+
+	static void Write(const std::string& path, const std::vector<Vec3D>& vertices,
+		const std::vector<Face>& faces) {
+		std::ofstream file(path, std::ios::binary);
+		const std::uint32_t sizes[2] = { sizeof(FloatType), sizeof(IndexType) };
+		const std::uint64_t counts[2] = { vertices.size(), faces.size() };
+		file.write(magic, sizeof(magic));
+		file.write(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+		file.write(reinterpret_cast<const char*>(counts), sizeof(counts));
+		for (const auto& vertex : vertices) {
+			file.write(reinterpret_cast<const char*>(vertex.data()), vertexSize);
+		}
+		for (const auto& face : faces) {
+			file.write(reinterpret_cast<const char*>(face.data()), faceSize);
+		}
+		if (!file) {
+			throw std::runtime_error("could not write mesh file " + path);
+		}
+	}
+
+private:
+	static constexpr char magic[8] = { 'M','P','I','M','E','S','H','1' };
+	static const size_t headerSize = 32;
+	static const size_t vertexSize = 3 * sizeof(FloatType);
+	static const size_t faceSize = 3 * sizeof(IndexType);
+
+	const MappedFile file;
+	const char* const data;
+	const size_t size;
+	size_t vertexCount = 0, faceCount = 0;
+	size_t vertexStart = 0, faceStart = 0;
+
+	void ReadHeader() {
+		std::uint32_t sizes[2];
+		std::uint64_t counts[2];
+		if (size < headerSize || std::memcmp(data, magic, sizeof(magic)) != 0) {
+			throw std::runtime_error("not a mesh file");
+		}
+		std::memcpy(sizes, data + 8, sizeof(sizes));
+		std::memcpy(counts, data + 16, sizeof(counts));
+		if (sizes[0] != sizeof(FloatType) || sizes[1] != sizeof(IndexType)) {
+			throw std::runtime_error("mesh file has different coordinate or index types");
+		}
+		if (counts[0] > (size - headerSize) / vertexSize) {
+			throw std::runtime_error("mesh file size doesn't match its counts");
+		}
+		vertexCount = static_cast<size_t>(counts[0]);
+		vertexStart = headerSize;
+		faceStart = vertexStart + vertexCount * vertexSize;
+		if (counts[1] > (size - faceStart) / faceSize ||
+			faceStart + static_cast<size_t>(counts[1]) * faceSize != size) {
+			throw std::runtime_error("mesh file size doesn't match its counts");
+		}
+		faceCount = static_cast<size_t>(counts[1]);
+	}
+};
+
+template <class FloatType, class IndexType>
+constexpr char MappedMeshFile<FloatType, IndexType>::magic[8];
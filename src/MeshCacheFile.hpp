@@ -0,0 +1,328 @@
+#pragma once
+#include "MeshPlaneIntersect.hpp"
+#include "MappedFile.hpp"
+#include <string>
+#include <stdexcept>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+
+// a mesh saved along with whatever has been built for it, its topology, vertex arrays and
+// face hierarchy, as flat arrays that are used straight from the memory mapped file. the
+// mesh is ready as soon as the file is mapped, with nothing parsed or built and only the
+// header read, and processes mapping the same file share its pages. the layout, in the byte order of the
+// machine that wrote it, is
+//   char[8]                          "MPICACH1"
+//   uint32                           sizeof(FloatType)
+//   uint32                           sizeof(IndexType)
+//   uint32                           the structures held: 1 topology, 2 vertex arrays,
+//                                    4 face hierarchy
+//   uint32                           array count, 13
+//   uint64[3 * array count]          the offset from the start of the file, item count
+//                                    and item size of each array
+// followed by the arrays, each starting on a multiple of 64 bytes, in the order
+//   vertices, faces,
+//   half edge twins (64 bit), free edges, free edge ends, free edge vertices,
+//   vertex starts, vertex edges (the topology),
+//   x, y, z (the vertex arrays),
+//   hierarchy nodes, hierarchy faces (the face hierarchy)
+// the arrays of the structures that weren't built are empty. opening the file only checks
+// the header and that the arrays fit in the file and match each other in length, which
+// doesn't touch the arrays themselves. Validate goes through every vertex, face and edge
+// number in them, for files that may be corrupt or stale
+template <class FloatType, class IndexType>
+class MeshCacheFile {
+
+public:
+	typedef typename MeshPlaneIntersect<FloatType, IndexType>::Mesh Mesh;
+
+	// throws std::runtime_error if the file can't be mapped, isn't a cache file of this
+	// version, was written with other types or its arrays don't fit in it
+	explicit MeshCacheFile(const std::string& path) :
+		file(path), data(file.Data()), size(file.Size()), mesh(ReadMesh()) {}
+
+	// throws std::runtime_error if any number in the arrays is out of range, which a
+	// query would read out of bounds with. this reads the whole file, so it is left to
+	// callers that can't trust where the file came from
+	void Validate() const {
+		Arrays arrays;
+		if (!AreNumbersValid(arrays, ArraysOf(mesh, arrays))) {
+			throw std::runtime_error("mesh cache file holds numbers out of range");
+		}
+	}
+
+	// the mesh refers to the mapped arrays, so the file has to outlive it and any copies
+	const Mesh& GetMesh() const {
+		return mesh;
+	}
+
+	// writes the mesh with its topology, vertex arrays and face hierarchy, for those that
+	// have been built. build them all first for the fastest start up
+	static void Write(const std::string& path, const Mesh& mesh) {
+		std::ofstream file(path, std::ios::binary);
+		Arrays arrays;
+		const std::uint32_t structures(ArraysOf(mesh, arrays));
+
+		std::uint64_t table[3 * arrayCount];
+		size_t offset(headerSize);
+		arrays.ForEach([&table, &offset](const int i, const char* bytes, const size_t count,
+			const size_t itemSize) {
+			static_cast<void>(bytes);
+			offset = Aligned(offset);
+			table[3 * i] = offset;
+			table[3 * i + 1] = count;
+			table[3 * i + 2] = itemSize;
+			offset += count * itemSize;
+		});
+		const std::uint32_t header[4] = { sizeof(FloatType), sizeof(IndexType), structures,
+			arrayCount };
+		file.write(magic, sizeof(magic));
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(table), sizeof(table));
+		offset = headerSize;
+		arrays.ForEach([&file, &offset](const int, const char* bytes, const size_t count,
+			const size_t itemSize) {
+			static const char padding[alignment] = {};
+			file.write(padding, Aligned(offset) - offset);
+			offset = Aligned(offset);
+			file.write(bytes, count * itemSize);
+			offset += count * itemSize;
+		});
+		if (!file) {
+			throw std::runtime_error("could not write mesh cache file " + path);
+		}
+	}
+
+private:
+	typedef typename Mesh::Index Index;
+	typedef typename Mesh::Edge Edge;
+	typedef typename Mesh::FaceHierarchy::Node Node;
+	template <typename Type>
+	using ArrayView = typename MeshPlaneIntersect<FloatType, IndexType>::template ArrayView<Type>;
+
+	static constexpr char magic[8] = { 'M','P','I','C','A','C','H','1' };
+	static const std::uint32_t arrayCount = 13;
+	static const size_t headerSize = 8 + 4 * 4 + 3 * 8 * arrayCount;
+	static const size_t alignment = 64;
+	static const std::uint32_t hasTopology = 1, hasVertexArrays = 2, hasFaceHierarchy = 4;
+
+	// the arrays in the order they are laid out
+	struct Arrays {
+		ArrayView<typename MeshPlaneIntersect<FloatType, IndexType>::Vec3D> vertices;
+		ArrayView<typename MeshPlaneIntersect<FloatType, IndexType>::Face> faces;
+		ArrayView<typename Mesh::HalfEdgeIndex> twins;
+		typename Mesh::FreeEdgeView freeEdges;
+		std::array<ArrayView<FloatType>, 3> coordinates;
+		ArrayView<Node> nodes;
+		ArrayView<Index> hierarchyFaces;
+
+		template <typename Function>
+		void ForEach(Function function) {
+			int i(0);
+			const auto visit = [&function, &i](auto& array) {
+				function(i++, reinterpret_cast<const char*>(array.data()), array.size(),
+					sizeof(*array.data()));
+			};
+			visit(vertices);
+			visit(faces);
+			visit(twins);
+			visit(freeEdges.edges);
+			visit(freeEdges.edgeEnds);
+			visit(freeEdges.vertices);
+			visit(freeEdges.vertexStarts);
+			visit(freeEdges.vertexEdges);
+			for (auto& coordinate : coordinates) {
+				visit(coordinate);
+			}
+			visit(nodes);
+			visit(hierarchyFaces);
+		}
+	};
+
+	const MappedFile file;
+	const char* const data;
+	const size_t size;
+	const Mesh mesh;
+
+	// points arrays at those of the mesh and what has been built for it, and returns the
+	// structures held
+	static std::uint32_t ArraysOf(const Mesh& mesh, Arrays& arrays) {
+		const Mesh current(mesh.Current());
+		arrays.vertices = current.vertices;
+		arrays.faces = current.faces;
+		std::uint32_t structures(0);
+		if (mesh.topology) {
+			structures |= hasTopology;
+			arrays.twins = mesh.topology->twins;
+			arrays.freeEdges = mesh.topology->freeEdges;
+		}
+		if (mesh.vertexArrays) {
+			structures |= hasVertexArrays;
+			arrays.coordinates = mesh.vertexArrays->coordinates;
+		}
+		if (mesh.faceHierarchy) {
+			structures |= hasFaceHierarchy;
+			arrays.nodes = mesh.faceHierarchy->nodes;
+			arrays.hierarchyFaces = mesh.faceHierarchy->faces;
+		}
+		return structures;
+	}
+
+	static size_t Aligned(const size_t offset) {
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+
+	// whether each value is from first up to but not including end
+	template <typename Type>
+	static bool AreInRange(const ArrayView<Type> values, const std::int64_t first,
+		const std::int64_t end) {
+		for (const auto& value : values) {
+			if (static_cast<std::int64_t>(value) < first || static_cast<std::int64_t>(value) >= end) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static bool AreNumbersValid(const Arrays& arrays, const std::uint32_t structures) {
+		const Index vertexCount(static_cast<Index>(arrays.vertices.size()));
+		const Index faceCount(static_cast<Index>(arrays.faces.size()));
+		for (const auto& face : arrays.faces) {
+			if (!AreInRange(ArrayView<IndexType>(face.data(), 3), 0, vertexCount)) {
+				return false;
+			}
+		}
+		if (structures & hasTopology) {
+			const auto& freeEdges(arrays.freeEdges);
+			const Index freeVertexCount(static_cast<Index>(freeEdges.vertices.size()));
+			if (!AreInRange(arrays.twins, -1, 3 * static_cast<std::int64_t>(faceCount)) ||
+				!AreInRange(freeEdges.vertices, 0, vertexCount) ||
+				!AreInRange(freeEdges.vertexEdges, 0, static_cast<Index>(freeEdges.edges.size()))) {
+				return false;
+			}
+			for (size_t i(0); i < freeEdges.edges.size(); ++i) {
+				const auto& edge(freeEdges.edges[i]);
+				const auto& ends(freeEdges.edgeEnds[i]);
+				if (edge.first < 0 || edge.first >= vertexCount || edge.second < 0 ||
+					edge.second >= vertexCount || ends.first < 0 || ends.first >= freeVertexCount ||
+					ends.second < 0 || ends.second >= freeVertexCount) {
+					return false;
+				}
+			}
+			const auto& starts(freeEdges.vertexStarts);
+			if (starts.front() != 0 || starts.back() != freeEdges.vertexEdges.size()) {
+				return false;
+			}
+			for (size_t i(1); i < starts.size(); ++i) {
+				if (starts[i] < starts[i - 1]) {
+					return false;
+				}
+			}
+		}
+		if (structures & hasFaceHierarchy) {
+			// children come after their parents, so walking the hierarchy always ends
+			const auto& nodes(arrays.nodes);
+			const Index nodeCount(static_cast<Index>(nodes.size()));
+			for (Index iNode(0); iNode < nodeCount; ++iNode) {
+				const auto& node(nodes[iNode]);
+				const bool isLeaf(node.count > 0 || (nodeCount == 1 && node.count == 0));
+				if (node.count < 0 || (isLeaf && (node.first < 0 || node.first > faceCount - node.count)) ||
+					(!isLeaf && (node.first <= iNode || node.first >= nodeCount - 1))) {
+					return false;
+				}
+			}
+			if (!AreInRange(arrays.hierarchyFaces, 0, faceCount)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	Mesh ReadMesh() const {
+		std::uint32_t header[4];
+		if (size < headerSize || std::memcmp(data, magic, sizeof(magic)) != 0) {
+			throw std::runtime_error("not a mesh cache file of this version");
+		}
+		std::memcpy(header, data + 8, sizeof(header));
+		if (header[0] != sizeof(FloatType) || header[1] != sizeof(IndexType)) {
+			throw std::runtime_error("mesh cache file has different coordinate or index types");
+		}
+		if (header[3] != arrayCount) {
+			throw std::runtime_error("not a mesh cache file of this version");
+		}
+		const std::uint32_t structures(header[2]);
+
+		// the arrays are pointed at where they lie, once their bounds have been checked
+		std::uint64_t table[3 * arrayCount];
+		std::memcpy(table, data + 8 + sizeof(header), sizeof(table));
+		Arrays arrays;
+		const char* const fileData(data);
+		const size_t fileSize(size);
+		arrays.ForEach([&table, fileData, fileSize](const int i, const char*, const size_t,
+			const size_t itemSize) {
+			const std::uint64_t offset(table[3 * i]), count(table[3 * i + 1]);
+			if (table[3 * i + 2] != itemSize) {
+				throw std::runtime_error("mesh cache file was written with other types");
+			}
+			if (offset < headerSize || offset % alignment != 0 || offset > fileSize ||
+				count > (fileSize - offset) / itemSize) {
+				throw std::runtime_error("mesh cache file size doesn't match its arrays");
+			}
+		});
+		const auto view = [this, &table](const int i, auto& array) {
+			typedef typename std::remove_reference<decltype(array[0])>::type Item;
+			array = { reinterpret_cast<Item*>(data + table[3 * i]),
+				static_cast<size_t>(table[3 * i + 1]) };
+		};
+		view(0, arrays.vertices);
+		view(1, arrays.faces);
+		view(2, arrays.twins);
+		view(3, arrays.freeEdges.edges);
+		view(4, arrays.freeEdges.edgeEnds);
+		view(5, arrays.freeEdges.vertices);
+		view(6, arrays.freeEdges.vertexStarts);
+		view(7, arrays.freeEdges.vertexEdges);
+		for (int i(0); i < 3; ++i) {
+			view(8 + i, arrays.coordinates[i]);
+		}
+		view(11, arrays.nodes);
+		view(12, arrays.hierarchyFaces);
+
+		// the counts that tie the arrays together, without looking through them
+		const auto& freeEdges(arrays.freeEdges);
+		if (((structures & hasTopology) && (arrays.twins.size() != 3 * arrays.faces.size() ||
+			freeEdges.edgeEnds.size() != freeEdges.edges.size() ||
+			freeEdges.vertexStarts.size() != freeEdges.vertices.size() + 1 ||
+			freeEdges.vertexEdges.size() != 2 * freeEdges.edges.size())) ||
+			((structures & hasVertexArrays) && (arrays.coordinates[0].size() != arrays.vertices.size() ||
+			arrays.coordinates[1].size() != arrays.vertices.size() ||
+			arrays.coordinates[2].size() != arrays.vertices.size())) ||
+			((structures & hasFaceHierarchy) && (arrays.nodes.empty() ||
+			arrays.hierarchyFaces.size() != arrays.faces.size()))) {
+			throw std::runtime_error("mesh cache file arrays don't match each other");
+		}
+
+		Mesh mesh(arrays.vertices, arrays.faces);
+		if (structures & hasTopology) {
+			auto topology(std::make_shared<typename Mesh::Topology>());
+			topology->twins = arrays.twins;
+			topology->freeEdges = arrays.freeEdges;
+			mesh.topology = topology;
+		}
+		if (structures & hasVertexArrays) {
+			auto vertexArrays(std::make_shared<typename Mesh::VertexArrays>());
+			vertexArrays->coordinates = arrays.coordinates;
+			mesh.vertexArrays = vertexArrays;
+		}
+		if (structures & hasFaceHierarchy) {
+			auto faceHierarchy(std::make_shared<typename Mesh::FaceHierarchy>());
+			faceHierarchy->nodes = arrays.nodes;
+			faceHierarchy->faces = arrays.hierarchyFaces;
+			mesh.faceHierarchy = faceHierarchy;
+		}
+		return mesh;
+	}
+};
+
+template <class FloatType, class IndexType>
+constexpr char MeshCacheFile<FloatType, IndexType>::magic[8];
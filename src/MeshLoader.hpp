@@ -0,0 +1,513 @@
+#pragma once
+#include "MeshPlaneIntersect.hpp"
+#include "MappedFile.hpp"
+#include <vector>
+#include <array>
+#include <string>
+#include <stdexcept>
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cctype>
+
+// loads binary STL, PLY and OBJ files into the vertices and faces a Mesh is made from.
+// the files are memory mapped and parsed where they lie. points closer together than
+// 'tolerance' are welded into one vertex with a spatial hash, and faces left with two
+// corners on the same vertex are dropped. a tolerance of 0 only welds identical points.
+// polygons are split into fans of triangles. throws std::runtime_error for files that
+// can't be read
+template <class FloatType, class IndexType>
+class MeshLoader {
+
+public:
+	typedef typename MeshPlaneIntersect<FloatType, IndexType>::Vec3D Vec3D;
+	typedef typename MeshPlaneIntersect<FloatType, IndexType>::Face Face;
+
+	// picks the loader from the file extension
+	static void Load(const std::string& path, std::vector<Vec3D>& vertices,
+		std::vector<Face>& faces, const FloatType tolerance = 0, const size_t threadCount = 1) {
+		std::string extension(path.substr(std::min(path.size(), path.find_last_of('.'))));
+		std::transform(extension.begin(), extension.end(), extension.begin(),
+			[](const char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+		if (extension == ".stl") {
+			LoadStl(path, vertices, faces, tolerance, threadCount);
+		}
+		else if (extension == ".ply") {
+			LoadPly(path, vertices, faces, tolerance, threadCount);
+		}
+		else if (extension == ".obj") {
+			LoadObj(path, vertices, faces, tolerance);
+		}
+		else {
+			throw std::runtime_error("unknown mesh file type " + path);
+		}
+	}
+
+	// the triangles are fixed size records, so they are read on threadCount threads
+	static void LoadStl(const std::string& path, std::vector<Vec3D>& vertices,
+		std::vector<Face>& faces, const FloatType tolerance = 0, const size_t threadCount = 1) {
+		const MappedFile file(path);
+		const char* data(file.Data());
+		if (file.Size() < 84) {
+			throw std::runtime_error("not a binary STL file " + path);
+		}
+		const size_t triangleCount(ReadValue<std::uint32_t>(data + 80, false));
+		if ((file.Size() - 84) / 50 < triangleCount) {
+			throw std::runtime_error("not a binary STL file " + path);
+		}
+		std::vector<Vec3D> points(triangleCount * 3);
+		Mesh::ParallelFor(threadCount, triangleCount, chunkSize, [&](size_t, const size_t begin,
+			const size_t end) {
+			for (size_t iTriangle(begin); iTriangle < end; ++iTriangle) {
+				// each record is a normal, three corners and two attribute bytes
+				const char* record(data + 84 + iTriangle * 50 + 12);
+				for (size_t i(0); i < 9; ++i) {
+					points[iTriangle * 3 + i / 3][i % 3] = static_cast<FloatType>(
+						ReadValue<float>(record + i * 4, false));
+				}
+			}
+		});
+		Build(points, std::vector<size_t>(), tolerance, vertices, faces);
+	}
+
+	// ascii, binary_little_endian and binary_big_endian files with a "vertex" element
+	// holding x, y and z and a "face" element with a vertex_indices list. other elements
+	// and properties are skipped. binary vertices are read on threadCount threads
+	static void LoadPly(const std::string& path, std::vector<Vec3D>& vertices,
+		std::vector<Face>& faces, const FloatType tolerance = 0, const size_t threadCount = 1) {
+		const MappedFile file(path);
+		PlyReader reader(file.Data(), file.Data() + file.Size(), path);
+		std::vector<Vec3D> points;
+		std::vector<size_t> corners;
+		reader.Read(points, corners, threadCount);
+		Build(points, corners, tolerance, vertices, faces);
+	}
+
+	// reads the "v" and "f" lines, with face indices counted from 1 or back from the
+	// end if negative. texture and normal indices are ignored
+	static void LoadObj(const std::string& path, std::vector<Vec3D>& vertices,
+		std::vector<Face>& faces, const FloatType tolerance = 0) {
+		const MappedFile file(path);
+		const char* position(file.Data());
+		const char* const end(file.Data() + file.Size());
+		std::vector<Vec3D> points;
+		std::vector<size_t> corners, polygon;
+		while (position < end) {
+			const char* line(position);
+			const char* const lineEnd(std::find(position, end, '\n'));
+			position = lineEnd < end ? lineEnd + 1 : end;
+			SkipSpace(line, lineEnd);
+			if (lineEnd - line < 2 || (line[1] != ' ' && line[1] != '\t')) {
+				continue;
+			}
+			const char* token(line + 2);
+			if (line[0] == 'v') {
+				Vec3D point;
+				for (auto& coordinate : point) {
+					coordinate = static_cast<FloatType>(ParseNumber(token, lineEnd, path));
+				}
+				points.push_back(point);
+			}
+			else if (line[0] == 'f') {
+				polygon.clear();
+				while (SkipSpace(token, lineEnd) < lineEnd) {
+					// the vertex is the number before any '/'
+					const long long index(static_cast<long long>(ParseNumber(token, lineEnd, path)));
+					if (index == 0 || (index < 0 && static_cast<size_t>(-index) > points.size())) {
+						throw std::runtime_error("bad face in " + path);
+					}
+					polygon.push_back(index > 0 ? static_cast<size_t>(index - 1) :
+						points.size() - static_cast<size_t>(-index));
+					while (token < lineEnd && *token != ' ' && *token != '\t' && *token != '\r') {
+						++token;
+					}
+				}
+				AddPolygon(polygon, corners);
+			}
+		}
+		for (const auto& corner : corners) {
+			if (corner >= points.size()) {
+				throw std::runtime_error("bad face in " + path);
+			}
+		}
+		Build(points, corners, tolerance, vertices, faces);
+	}
+
+	// gives each point the index of its vertex in vertices. a point is welded to the
+	// lowest numbered vertex within the tolerance of it, if there is one
+	static void WeldPoints(const std::vector<Vec3D>& points, const FloatType tolerance,
+		std::vector<Vec3D>& vertices, std::vector<size_t>& pointVertices) {
+		const size_t none(std::numeric_limits<size_t>::max());
+		std::unordered_map<Cell, size_t, CellHash> cells;
+		std::vector<size_t> nextInCell;
+		cells.reserve(points.size());
+		vertices.clear();
+		pointVertices.resize(points.size());
+		const int cornerCount(tolerance > 0 ? 8 : 1);
+		for (size_t iPoint(0); iPoint < points.size(); ++iPoint) {
+			const auto& point(points[iPoint]);
+			Cell cell, side;
+			PointCell(point, tolerance, cell, side);
+			size_t found(none);
+			// the cell and those next to it on the sides the point is nearest
+			for (int corner(0); corner < cornerCount; ++corner) {
+				const auto neighbour(cells.find({ cell[0] + (corner & 1 ? side[0] : 0),
+					cell[1] + (corner & 2 ? side[1] : 0), cell[2] + (corner & 4 ? side[2] : 0) }));
+				if (neighbour == cells.end()) {
+					continue;
+				}
+				for (size_t iVertex(neighbour->second); iVertex != none; iVertex = nextInCell[iVertex]) {
+					if (iVertex < found && IsWithin(vertices[iVertex], point, tolerance)) {
+						found = iVertex;
+					}
+				}
+			}
+			if (found == none) {
+				found = vertices.size();
+				vertices.push_back(point);
+				const auto inserted(cells.emplace(cell, found));
+				nextInCell.push_back(inserted.second ? none : inserted.first->second);
+				inserted.first->second = found;
+			}
+			pointVertices[iPoint] = found;
+		}
+	}
+
+private:
+	// the records are read with the mesh's thread splitting, in chunks of at least this many
+	typedef typename MeshPlaneIntersect<FloatType, IndexType>::Mesh Mesh;
+	static const size_t chunkSize = 4096;
+
+	typedef std::array<long long, 3> Cell;
+	struct CellHash {
+		size_t operator()(const Cell& cell) const {
+			std::uint64_t hash(0);
+			for (const auto& coordinate : cell) {
+				hash = (hash ^ static_cast<std::uint64_t>(coordinate)) * 0x9E3779B97F4A7C15ull;
+			}
+			return static_cast<size_t>(hash ^ (hash >> 32));
+		}
+	};
+
+	// cells are twice the tolerance wide, so a point can only be welded to one in its own
+	// cell or the next one towards it along each axis, given by side. with no tolerance the
+	// cell only has to be the same for identical points
+	static void PointCell(const Vec3D& point, const FloatType tolerance, Cell& cell, Cell& side) {
+		const FloatType limit(static_cast<FloatType>(1ll << 60));
+		for (int i(0); i < 3; ++i) {
+			if (tolerance > 0) {
+				const FloatType scaled(point[i] / (2 * tolerance));
+				const FloatType floor(std::floor(scaled));
+				cell[i] = static_cast<long long>(std::max(-limit, std::min(limit, floor)));
+				side[i] = scaled - floor < FloatType(0.5) ? -1 : 1;
+			}
+			else {
+				// adding zero turns -0 into 0
+				cell[i] = static_cast<long long>(std::hash<FloatType>()(point[i] + 0));
+				side[i] = 0;
+			}
+		}
+	}
+
+	static bool IsWithin(const Vec3D& vertex, const Vec3D& point, const FloatType tolerance) {
+		FloatType distance(0);
+		for (int i(0); i < 3; ++i) {
+			distance += (vertex[i] - point[i]) * (vertex[i] - point[i]);
+		}
+		return tolerance > 0 ? distance <= tolerance * tolerance : vertex == point;
+	}
+
+	// welds the points, and makes a face of each three corners, or each three points if
+	// there are no corners
+	static void Build(const std::vector<Vec3D>& points, const std::vector<size_t>& corners,
+		const FloatType tolerance, std::vector<Vec3D>& vertices, std::vector<Face>& faces) {
+		std::vector<size_t> pointVertices;
+		WeldPoints(points, tolerance, vertices, pointVertices);
+		const size_t cornerCount(corners.empty() ? points.size() : corners.size());
+		faces.clear();
+		faces.reserve(cornerCount / 3);
+		for (size_t iCorner(0); iCorner + 2 < cornerCount; iCorner += 3) {
+			Face face;
+			for (int i(0); i < 3; ++i) {
+				const size_t point(corners.empty() ? iCorner + i : corners[iCorner + i]);
+				face[i] = static_cast<IndexType>(pointVertices[point]);
+			}
+			if (face[0] != face[1] && face[1] != face[2] && face[2] != face[0]) {
+				faces.push_back(face);
+			}
+		}
+	}
+
+	static void AddPolygon(const std::vector<size_t>& polygon, std::vector<size_t>& corners) {
+		for (size_t i(1); i + 1 < polygon.size(); ++i) {
+			corners.push_back(polygon[0]);
+			corners.push_back(polygon[i]);
+			corners.push_back(polygon[i + 1]);
+		}
+	}
+
+	template <typename Type>
+	static Type ReadValue(const char* data, const bool isBigEndian) {
+		const std::uint16_t probe(1);
+		const bool isHostBigEndian(*reinterpret_cast<const unsigned char*>(&probe) == 0);
+		char bytes[sizeof(Type)];
+		std::memcpy(bytes, data, sizeof(Type));
+		if (isBigEndian != isHostBigEndian) {
+			std::reverse(bytes, bytes + sizeof(Type));
+		}
+		Type value;
+		std::memcpy(&value, bytes, sizeof(Type));
+		return value;
+	}
+
+	// moves past spaces, tabs and carriage returns, but not line ends
+	static const char* SkipSpace(const char*& position, const char* end) {
+		while (position < end && (*position == ' ' || *position == '\t' || *position == '\r')) {
+			++position;
+		}
+		return position;
+	}
+
+	// reads the number at position, which is left after it. the text is copied out so
+	// that strtod can't run past the end of the file
+	static double ParseNumber(const char*& position, const char* end, const std::string& path) {
+		SkipSpace(position, end);
+		char text[64];
+		size_t length(0);
+		while (position + length < end && length + 1 < sizeof(text) &&
+			std::strchr(" \t\r\n/", position[length]) == nullptr) {
+			text[length] = position[length];
+			++length;
+		}
+		text[length] = 0;
+		char* parsed;
+		const double value(std::strtod(text, &parsed));
+		if (length == 0 || parsed != text + length) {
+			throw std::runtime_error("bad number in " + path);
+		}
+		position += length;
+		return value;
+	}
+
+	class PlyReader {
+	public:
+		PlyReader(const char* begin, const char* end, const std::string& path) :
+			position(begin), end(end), path(path) {
+			ReadHeader();
+		}
+
+		void Read(std::vector<Vec3D>& points, std::vector<size_t>& corners,
+			const size_t threadCount) {
+			std::vector<size_t> polygon;
+			for (const auto& element : elements) {
+				const bool isVertex(element.name == "vertex");
+				const bool isFace(element.name == "face");
+				std::array<int, 3> coordinates{ -1, -1, -1 };
+				std::array<size_t, 3> coordinateOffsets{ 0, 0, 0 };
+				int indices(-1);
+				// the size of each record, if it has no lists
+				size_t recordSize(0);
+				bool isFixedSize(true);
+				for (size_t i(0); i < element.properties.size(); ++i) {
+					const auto& property(element.properties[i]);
+					for (int j(0); j < 3; ++j) {
+						if (property.name.size() == 1 && property.name[0] == 'x' + j) {
+							coordinates[j] = static_cast<int>(i);
+							coordinateOffsets[j] = recordSize;
+						}
+					}
+					if (property.isList && (property.name == "vertex_indices" ||
+						property.name == "vertex_index")) {
+						indices = static_cast<int>(i);
+					}
+					isFixedSize = isFixedSize && !property.isList;
+					recordSize += TypeSize(property.type);
+				}
+				if (isVertex) {
+					if (*std::min_element(coordinates.begin(), coordinates.end()) < 0) {
+						throw std::runtime_error("no vertex coordinates in " + path);
+					}
+					points.resize(element.count);
+				}
+				if (isFace && indices < 0) {
+					throw std::runtime_error("no vertex indices in " + path);
+				}
+				if (isVertex && format != Ascii && isFixedSize) {
+					// fixed size records can be read in any order
+					if (static_cast<size_t>(end - position) / recordSize < element.count) {
+						throw std::runtime_error("unexpected end of " + path);
+					}
+					const char* const start(position);
+					Mesh::ParallelFor(threadCount, element.count, chunkSize, [&](size_t,
+						const size_t first, const size_t last) {
+						for (size_t iPoint(first); iPoint < last; ++iPoint) {
+							for (int j(0); j < 3; ++j) {
+								points[iPoint][j] = static_cast<FloatType>(ReadBinary(
+									start + iPoint * recordSize + coordinateOffsets[j],
+									element.properties[coordinates[j]].type));
+							}
+						}
+					});
+					position += element.count * recordSize;
+					continue;
+				}
+				for (size_t iRecord(0); iRecord < element.count; ++iRecord) {
+					for (size_t i(0); i < element.properties.size(); ++i) {
+						const auto& property(element.properties[i]);
+						if (!property.isList) {
+							const double value(ReadNumber(property.type));
+							for (int j(0); j < 3; ++j) {
+								if (isVertex && coordinates[j] == static_cast<int>(i)) {
+									points[iRecord][j] = static_cast<FloatType>(value);
+								}
+							}
+							continue;
+						}
+						const size_t count(static_cast<size_t>(ReadNumber(property.countType)));
+						polygon.clear();
+						for (size_t j(0); j < count; ++j) {
+							const double value(ReadNumber(property.type));
+							if (isFace && indices == static_cast<int>(i)) {
+								if (value < 0 || value >= static_cast<double>(points.size())) {
+									throw std::runtime_error("bad face in " + path);
+								}
+								polygon.push_back(static_cast<size_t>(value));
+							}
+						}
+						AddPolygon(polygon, corners);
+					}
+				}
+			}
+		}
+
+	private:
+		enum Format { Ascii, LittleEndian, BigEndian };
+		enum Type { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64 };
+		struct Property {
+			std::string name;
+			Type type, countType;
+			bool isList;
+		};
+		struct Element {
+			std::string name;
+			size_t count;
+			std::vector<Property> properties;
+		};
+		const char* position;
+		const char* const end;
+		const std::string& path;
+		Format format = Ascii;
+		std::vector<Element> elements;
+
+		void ReadHeader() {
+			std::vector<std::string> words;
+			bool isFirstLine(true);
+			while (true) {
+				if (position >= end) {
+					throw std::runtime_error("no end_header in " + path);
+				}
+				const char* const lineEnd(std::find(position, end, '\n'));
+				words.clear();
+				while (SkipSpace(position, lineEnd) < lineEnd) {
+					const char* const word(position);
+					while (position < lineEnd && *position != ' ' && *position != '\t' &&
+						*position != '\r') {
+						++position;
+					}
+					words.emplace_back(word, position);
+				}
+				position = lineEnd + (lineEnd < end);
+				if (isFirstLine) {
+					if (words.size() != 1 || words[0] != "ply") {
+						throw std::runtime_error("not a PLY file " + path);
+					}
+					isFirstLine = false;
+				}
+				else if (words.empty() || words[0] == "comment" || words[0] == "obj_info") {
+					continue;
+				}
+				else if (words[0] == "end_header") {
+					return;
+				}
+				else if (words[0] == "format" && words.size() > 1 && words[1] == "ascii") {
+					format = Ascii;
+				}
+				else if (words[0] == "format" && words.size() > 1 &&
+					words[1] == "binary_little_endian") {
+					format = LittleEndian;
+				}
+				else if (words[0] == "format" && words.size() > 1 &&
+					words[1] == "binary_big_endian") {
+					format = BigEndian;
+				}
+				else if (words[0] == "element" && words.size() == 3) {
+					elements.push_back({ words[1],
+						static_cast<size_t>(std::strtoull(words[2].c_str(), nullptr, 10)), {} });
+				}
+				else if (words[0] == "property" && !elements.empty() && words.size() == 3) {
+					elements.back().properties.push_back({ words[2], ParseType(words[1]), Int8, false });
+				}
+				else if (words[0] == "property" && !elements.empty() && words.size() == 5 &&
+					words[1] == "list") {
+					elements.back().properties.push_back({ words[4], ParseType(words[3]),
+						ParseType(words[2]), true });
+				}
+				else {
+					throw std::runtime_error("bad PLY header in " + path);
+				}
+			}
+		}
+
+		Type ParseType(const std::string& name) const {
+			static const char* const names[][2] = {
+				{ "char", "int8" }, { "uchar", "uint8" }, { "short", "int16" },
+				{ "ushort", "uint16" }, { "int", "int32" }, { "uint", "uint32" },
+				{ "float", "float32" }, { "double", "float64" } };
+			for (int i(0); i < 8; ++i) {
+				if (name == names[i][0] || name == names[i][1]) {
+					return static_cast<Type>(i);
+				}
+			}
+			throw std::runtime_error("unknown PLY type in " + path);
+		}
+
+		static size_t TypeSize(const Type type) {
+			static const size_t sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+			return sizes[type];
+		}
+
+		double ReadBinary(const char* data, const Type type) const {
+			const bool isBigEndian(format == BigEndian);
+			switch (type) {
+			case Int8: return ReadValue<std::int8_t>(data, isBigEndian);
+			case UInt8: return ReadValue<std::uint8_t>(data, isBigEndian);
+			case Int16: return ReadValue<std::int16_t>(data, isBigEndian);
+			case UInt16: return ReadValue<std::uint16_t>(data, isBigEndian);
+			case Int32: return ReadValue<std::int32_t>(data, isBigEndian);
+			case UInt32: return ReadValue<std::uint32_t>(data, isBigEndian);
+			case Float32: return ReadValue<float>(data, isBigEndian);
+			default: return ReadValue<double>(data, isBigEndian);
+			}
+		}
+
+		double ReadNumber(const Type type) {
+			if (format == Ascii) {
+				while (position < end && std::strchr(" \t\r\n", *position) != nullptr) {
+					++position;
+				}
+				return ParseNumber(position, end, path);
+			}
+			if (static_cast<size_t>(end - position) < TypeSize(type)) {
+				throw std::runtime_error("unexpected end of " + path);
+			}
+			const double value(ReadBinary(position, type));
+			position += TypeSize(type);
+			return value;
+		}
+	};
+};
@@ -1,15 +1,49 @@
 #pragma once
 #include <vector>
 #include <array>
-#include <map>
+#include <functional>
+#include <thread>
+#include <exception>
 #include <algorithm>
 #include <iterator>
+#include <limits>
+#include <cmath>
+#include <memory>
+#include <cstdint>
+#include <atomic>
+#include <type_traits>
+#include <future>
+#include <stdexcept>
+
+// vertex offsets are computed with AVX or SSE2 where the compiler targets them.
+// define MESH_PLANE_INTERSECT_NO_SIMD to always use the scalar loop
+#if !defined(MESH_PLANE_INTERSECT_NO_SIMD) && defined(__AVX__)
+#include <immintrin.h>
+#define MESH_PLANE_INTERSECT_AVX
+#elif !defined(MESH_PLANE_INTERSECT_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || \
+	(defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define MESH_PLANE_INTERSECT_SSE2
+#endif
+
+// define MESH_PLANE_INTERSECT_STATISTICS to have Intersect and Clip record the time taken
+// by each step and a few counts in their workspace. otherwise nothing is recorded
+#ifdef MESH_PLANE_INTERSECT_STATISTICS
+#include <chrono>
+#endif
+
+template <class FloatType, class IndexType>
+class MeshCacheFile;
+
+template <class FloatType, class IndexType>
+class MeshLoader;
 
 template <class FloatType, class IndexType>
 class MeshPlaneIntersect {
 
 public:
 	typedef std::array<FloatType, 3> Vec3D;
+	typedef std::array<FloatType, 2> Vec2D;
 	typedef std::array<IndexType, 3> Face;
 
 	struct Plane {
@@ -17,326 +51,3549 @@ public:
 		Vec3D normal = { 0,0,1 };
 	};
 
+	// the plane at 'position' along axis 0, 1 or 2 (x, y or z), with its normal along
+	// the axis when Sign is 1, or against it when Sign is -1. it cuts the mesh the same
+	// as ToPlane(), but each vertex offset is a single subtraction, and the points of
+	// the paths lie exactly at position along the axis
+	template <int Axis, int Sign = 1>
+	struct AxisPlane {
+		static_assert(Axis >= 0 && Axis < 3, "the axis is 0, 1 or 2");
+		static_assert(Sign == 1 || Sign == -1, "the sign is 1 or -1");
+		FloatType position = 0;
+
+		Plane ToPlane() const {
+			Plane plane;
+			plane.origin = { 0,0,0 };
+			plane.normal = { 0,0,0 };
+			plane.origin[Axis] = position;
+			plane.normal[Axis] = static_cast<FloatType>(Sign);
+			return plane;
+		}
+	};
+
 	struct Path3D {
 		std::vector<Vec3D> points;
 		bool isClosed = false;
 	};
 
+	// the points of all of the paths in one array, path i running from points[starts[i]]
+	// up to points[starts[i + 1]]
+	struct FlatPaths {
+		std::vector<Vec3D> points;
+		std::vector<size_t> starts;
+		std::vector<bool> isClosed;
+	};
+
+	// a point of a path as where it lies on an edge of the mesh, the fraction 'factor'
+	// of the way from vertex first to vertex second. points on a vertex have first and
+	// second the same, and factor 0
+	struct EdgePoint {
+		IndexType first, second;
+		FloatType factor;
+	};
+
+	// the paths as the edge points they pass through, laid out as in FlatPaths, for
+	// working out other values than the positions along the paths
+	struct SymbolicPaths {
+		std::vector<EdgePoint> points;
+		std::vector<size_t> starts;
+		std::vector<bool> isClosed;
+	};
+
+	// a value of 'width' numbers per vertex, stored vertex after vertex, and where its
+	// values at the points of some paths are to be written, point after point
+	struct Attribute {
+		const FloatType* vertexValues;
+		size_t width;
+		FloatType* pointValues;
+	};
+
+	// axes along a plane, at right angles to each other and of unit length, such that
+	// u x v is along the normal. u is taken at right angles to the normal from the axis
+	// the normal is least along, so for a normal of +z u and v are x and y
+	struct PlaneFrame {
+		Vec3D origin, u, v;
+
+		explicit PlaneFrame(const Plane& plane) : origin(plane.origin) {
+			const FloatType normalLength(std::sqrt(Dot(plane.normal, plane.normal)));
+			Vec3D normal;
+			for (int i(0); i < 3; ++i) {
+				normal[i] = plane.normal[i] / normalLength;
+			}
+			int axis(0);
+			for (int i(1); i < 3; ++i) {
+				if (std::abs(normal[i]) < std::abs(normal[axis])) {
+					axis = i;
+				}
+			}
+			u = { 0,0,0 };
+			u[axis] = 1;
+			for (int i(0); i < 3; ++i) {
+				u[i] -= normal[axis] * normal[i];
+			}
+			const FloatType uLength(std::sqrt(Dot(u, u)));
+			for (int i(0); i < 3; ++i) {
+				u[i] /= uLength;
+			}
+			v = { normal[1] * u[2] - normal[2] * u[1], normal[2] * u[0] - normal[0] * u[2],
+				normal[0] * u[1] - normal[1] * u[0] };
+		}
+
+		// the coordinates of a point along u and v, from the origin
+		Vec2D Coordinates(const Vec3D& point) const {
+			const Vec3D offset{ point[0] - origin[0], point[1] - origin[1], point[2] - origin[2] };
+			return { Dot(offset, u), Dot(offset, v) };
+		}
+
+		static FloatType Dot(const Vec3D& a, const Vec3D& b) {
+			return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+		}
+	};
+
+	// the area properties of the region inside a closed path, or of a whole section.
+	// areas are positive inside the mesh, so the region of a hole is negative and adds
+	// to the total as such. the second moments are the integrals of u squared, v squared
+	// and u times v over the area, about the centroid and along the PlaneFrame axes
+	struct AreaProperties {
+		FloatType area = 0, perimeter = 0;
+		Vec3D centroid = { 0,0,0 };
+		std::array<FloatType, 3> secondMoments = { 0,0,0 };
+	};
+
+	// a closed path of a section in the coordinates of its PlaneFrame. loops at an even
+	// depth are outlines, running anticlockwise, and those at an odd depth are holes in
+	// the loop around them, running clockwise
+	struct Polygon2D {
+		std::vector<Vec2D> points;
+		// the loop this one is directly inside, or -1, and the loops directly inside it
+		int parent = -1;
+		std::vector<int> children;
+		int depth = 0;
+	};
+
+	// vertices and faces of a mesh of its own, such as a part made by Split, which can be
+	// given straight to a Mesh
+	struct IndexedMesh {
+		std::vector<Vec3D> vertices;
+		std::vector<Face> faces;
+	};
+
+	// what the last query with a workspace did, see Workspace::GetStatistics
+	struct Statistics {
+		// the seconds taken by each step. with a face hierarchy the vertex offsets are
+		// found along with the crossing faces
+		double vertexOffsetSeconds = 0, crossingFaceSeconds = 0, edgePathSeconds = 0,
+			freeEdgeSeconds = 0, freeEdgePathSeconds = 0, chainSeconds = 0, pathSeconds = 0;
+		size_t crossingFaces = 0;
+		// the pieces of contour traced through the faces and along the free edges, and
+		// the paths they are chained into
+		size_t edgePaths = 0, freeEdgePaths = 0, chainedPaths = 0;
+		// slots looked at while finding path ends, about two per edge path unless the
+		// ends collide in the hash table
+		size_t chainProbes = 0;
+		size_t freeEdges = 0;
+		// the memory held by the workspace buffers after the query. the workspace only
+		// allocates when this grows
+		size_t workspaceBytes = 0, workspaceGrowthBytes = 0;
+	};
+
+	// a read only run of items held elsewhere, in a std::vector or a memory mapped file,
+	// with as much of the vector interface as the mesh needs
+	template <typename Type>
+	class ArrayView {
+	public:
+		ArrayView() = default;
+		ArrayView(const Type* items, const size_t count) : items(items), count(count) {}
+		ArrayView(const std::vector<Type>& vector) : items(vector.data()), count(vector.size()) {}
+
+		const Type* data() const { return items; }
+		size_t size() const { return count; }
+		bool empty() const { return count == 0; }
+		const Type* begin() const { return items; }
+		const Type* end() const { return items + count; }
+		const Type& front() const { return items[0]; }
+		const Type& back() const { return items[count - 1]; }
+		const Type& operator[](const size_t i) const { return items[i]; }
+
+		const Type& at(const size_t i) const {
+			if (i >= count) {
+				throw std::out_of_range("array view index out of range");
+			}
+			return items[i];
+		}
+
+	private:
+		const Type* items = nullptr;
+		size_t count = 0;
+	};
+
+	// thrown by a query once the cancel flag of its workspace is set, see
+	// Workspace::SetCancelFlag, and by SliceJob::Get for a cancelled job
+	class Cancelled : public std::runtime_error {
+	public:
+		Cancelled() : std::runtime_error("mesh plane intersection cancelled") {}
+	};
+
 	class Mesh {
 	public:
+		// the mesh refers to the vectors, so each query sees what they hold at the time,
+		// even after they have been refilled or have grown. what has been built for the
+		// mesh, such as its topology, has to be built again when they change
 		Mesh(const std::vector<Vec3D>& vertices, const std::vector<Face>& faces) :
+			vertexVector(&vertices), faceVector(&faces), vertices(vertices), faces(faces) {}
+
+		// the arrays can also be held elsewhere, such as in a memory mapped file. as with
+		// the vectors, they have to outlive the mesh, but here the mesh only sees the
+		// items it was made with
+		Mesh(const ArrayView<Vec3D> vertices, const ArrayView<Face> faces) :
 			vertices(vertices), faces(faces) {}
 
-		std::vector<Path3D> Intersect(const Plane& plane) const {
-			return _Execute(*this, plane, false);
+		// holds the buffers used while intersecting, see below
+		class Workspace;
+
+		// threadCount splits the work over that many threads, with the same result. with a
+		// tolerance above 0, points are left out of the paths as they are worked out, as
+		// long as each is within that distance of the segment that replaces it. the ends of
+		// open paths and the first point of closed ones are kept
+		std::vector<Path3D> Intersect(const Plane& plane, const size_t threadCount = 1,
+			const FloatType tolerance = 0) const {
+			Workspace workspace;
+			std::vector<Path3D> result;
+			Intersect(plane, workspace, result, threadCount, tolerance);
+			return result;
 		}
 
-		std::vector<Path3D> Clip(const Plane& plane) const {
-			return _Execute(*this, plane, true);
+		std::vector<Path3D> Clip(const Plane& plane, const size_t threadCount = 1,
+			const FloatType tolerance = 0) const {
+			Workspace workspace;
+			std::vector<Path3D> result;
+			Clip(plane, workspace, result, threadCount, tolerance);
+			return result;
 		}
 
-	private:
-		const std::vector<Vec3D>& vertices;
-		const std::vector<Face>& faces;
-
-		typedef std::pair<int, int> Edge;
-		typedef std::vector<Edge> EdgePath;
-		static std::vector<Path3D> _Execute(const Mesh& mesh, const Plane& plane,
-			const bool isClip) {
-			const auto vertexOffsets(VertexOffsets(mesh.vertices, plane));
-			auto edgePaths(EdgePaths(mesh.faces, vertexOffsets));
-			if (isClip) {
-				auto freeEdges = FreeEdges(mesh.faces, vertexOffsets);
-				auto freeEdgePaths = FreeEdgePaths(freeEdges, vertexOffsets);
-				edgePaths.insert(edgePaths.end(), freeEdgePaths.begin(), freeEdgePaths.end());
+		// the same as above, but the buffers are kept in the workspace and the paths are
+		// written over the ones already in result, so once these have grown to fit, later
+		// single threaded queries don't allocate any memory. a workspace can be used with
+		// any mesh, but only by one query at a time
+		void Intersect(const Plane& plane, Workspace& workspace, std::vector<Path3D>& result,
+			const size_t threadCount = 1, const FloatType tolerance = 0) const {
+			const Mesh mesh(Current());
+			_Execute(mesh, plane, false, threadCount, workspace);
+			{
+				StepTimer timer(workspace.statistics.pathSeconds);
+				ConstructGeometricPaths(mesh, plane, workspace.chainedPaths, workspace.vertexOffsets,
+					threadCount, result, tolerance);
 			}
-			ChainEdgePaths(edgePaths);
-			return ConstructGeometricPaths(mesh, edgePaths, vertexOffsets);
+			FinishStatistics(workspace);
 		}
 
-		static std::vector<EdgePath> EdgePaths(const std::vector<Face>& faces,
-			const std::vector<FloatType>& vertexOffsets) {
-			auto crossingFaces = CrossingFaces(faces, vertexOffsets);
-			std::vector<EdgePath> edgePaths;
-			while (crossingFaces.size() > 0) {
-				edgePaths.push_back(GetEdgePath(crossingFaces));
+		void Clip(const Plane& plane, Workspace& workspace, std::vector<Path3D>& result,
+			const size_t threadCount = 1, const FloatType tolerance = 0) const {
+			const Mesh mesh(Current());
+			_Execute(mesh, plane, true, threadCount, workspace);
+			{
+				StepTimer timer(workspace.statistics.pathSeconds);
+				ConstructGeometricPaths(mesh, plane, workspace.chainedPaths, workspace.vertexOffsets,
+					threadCount, result, tolerance);
 			}
-			return edgePaths;
+			FinishStatistics(workspace);
 		}
 
-		static std::vector<Path3D> ConstructGeometricPaths(const Mesh& mesh,
-			const std::vector<EdgePath>& edgePaths,
-			const std::vector<FloatType>& vertexOffsets) {
-			std::vector<Path3D> paths;
-			for (const auto& edgePath : edgePaths) {
-				Path3D path;
-				bool skipThisPoint = path.isClosed = edgePath.front() == edgePath.back();
-				for (const auto& edge : edgePath) {
-					if (skipThisPoint) {
-						skipThisPoint = false;
-					}
-					else if (edge.first == edge.second) {
-						path.points.push_back(mesh.vertices.at(edge.first));
-					}
-					else {
-						const auto& offset1(vertexOffsets[edge.first]);
-						const auto& offset2(vertexOffsets[edge.second]);
-						const auto factor = offset1 / (offset1 - offset2);
-						const auto& edgeStart(mesh.vertices.at(edge.first));
-						const auto& edgeEnd(mesh.vertices.at(edge.second));
-						Vec3D newPoint;
-						for (int i(0); i < 3; ++i) {
-							newPoint[i] = edgeStart[i] + (edgeEnd[i] - edgeStart[i]) * factor;
-						}
-						path.points.push_back(newPoint);
-					}
-				}
-				paths.push_back(path);
+		// the same as for plane.ToPlane(), except that the points are exactly at
+		// plane.position along the axis rather than rounded to near it
+		template <int Axis, int Sign>
+		std::vector<Path3D> Intersect(const AxisPlane<Axis, Sign>& plane,
+			const size_t threadCount = 1, const FloatType tolerance = 0) const {
+			Workspace workspace;
+			std::vector<Path3D> result;
+			Intersect(plane, workspace, result, threadCount, tolerance);
+			return result;
+		}
+
+		template <int Axis, int Sign>
+		std::vector<Path3D> Clip(const AxisPlane<Axis, Sign>& plane,
+			const size_t threadCount = 1, const FloatType tolerance = 0) const {
+			Workspace workspace;
+			std::vector<Path3D> result;
+			Clip(plane, workspace, result, threadCount, tolerance);
+			return result;
+		}
+
+		template <int Axis, int Sign>
+		void Intersect(const AxisPlane<Axis, Sign>& plane, Workspace& workspace,
+			std::vector<Path3D>& result, const size_t threadCount = 1,
+			const FloatType tolerance = 0) const {
+			const Mesh mesh(Current());
+			_Execute(mesh, plane, false, threadCount, workspace);
+			{
+				StepTimer timer(workspace.statistics.pathSeconds);
+				ConstructGeometricPaths(mesh, plane, workspace.chainedPaths, workspace.vertexOffsets,
+					threadCount, result, tolerance);
 			}
-			return paths;
+			FinishStatistics(workspace);
 		}
 
-		static const std::vector<FloatType> VertexOffsets(const std::vector<Vec3D>& vertices,
-			const Plane& plane) {
-			std::vector<FloatType> offsets;
-			offsets.reserve(vertices.size());
-			std::transform(vertices.begin(), vertices.end(), std::back_inserter(offsets),
-				[&plane](const auto& vertex) {
-					return VertexOffset(vertex, plane);
-				});
-			return offsets;
+		template <int Axis, int Sign>
+		void Clip(const AxisPlane<Axis, Sign>& plane, Workspace& workspace,
+			std::vector<Path3D>& result, const size_t threadCount = 1,
+			const FloatType tolerance = 0) const {
+			const Mesh mesh(Current());
+			_Execute(mesh, plane, true, threadCount, workspace);
+			{
+				StepTimer timer(workspace.statistics.pathSeconds);
+				ConstructGeometricPaths(mesh, plane, workspace.chainedPaths, workspace.vertexOffsets,
+					threadCount, result, tolerance);
+			}
+			FinishStatistics(workspace);
 		}
 
-		static FloatType VertexOffset(const Vec3D& vertex, const Plane& plane) {
-			FloatType offset(0);
-			for (int i(0); i < 3; ++i) {
-				offset += plane.normal[i] * (vertex[i] - plane.origin[i]);
+		// the paths as one array of points, replacing what was in result
+		void Intersect(const Plane& plane, Workspace& workspace, FlatPaths& result,
+			const size_t threadCount = 1) const {
+			const Mesh mesh(Current());
+			_Execute(mesh, plane, false, threadCount, workspace);
+			{
+				StepTimer timer(workspace.statistics.pathSeconds);
+				ConstructFlatPaths(mesh, plane, workspace.chainedPaths, workspace.vertexOffsets,
+					threadCount, result);
 			}
-			return offset;
+			FinishStatistics(workspace);
 		}
 
-		typedef std::map<Edge, int> CrossingFaceMap;
-		static CrossingFaceMap CrossingFaces(const std::vector<Face>& faces,
-			const std::vector<FloatType>& vertexOffsets) {
-			std::vector<std::pair<Edge, int>> crossingFaces;
-			for (const auto& face : faces) {
-				const bool edge1crosses = vertexOffsets[face[0]] * vertexOffsets[face[1]] < 0;
-				const bool edge2crosses = vertexOffsets[face[1]] * vertexOffsets[face[2]] < 0;
-				if (edge1crosses || edge2crosses) {
-					int oddVertex = edge2crosses - edge1crosses + 1;
-					const bool oddIsHigher = vertexOffsets[face[oddVertex]] > 0;
-					int v0 = oddVertex + 1 + oddIsHigher;
-					if (v0 > 2) {
-						v0 -= 3;
-					}
-					int v2 = oddVertex + 2 - oddIsHigher;
-					if (v2 > 2) {
-						v2 -= 3;
-					}
-					crossingFaces.push_back({
-						{ static_cast<int>(face[v0]), static_cast<int>(face[oddVertex]) },
-						static_cast<int>(face[v2]) });
-				}
+		void Clip(const Plane& plane, Workspace& workspace, FlatPaths& result,
+			const size_t threadCount = 1) const {
+			const Mesh mesh(Current());
+			_Execute(mesh, plane, true, threadCount, workspace);
+			{
+				StepTimer timer(workspace.statistics.pathSeconds);
+				ConstructFlatPaths(mesh, plane, workspace.chainedPaths, workspace.vertexOffsets,
+					threadCount, result);
 			}
-			return CrossingFaceMap(crossingFaces.begin(), crossingFaces.end());
+			FinishStatistics(workspace);
 		}
 
-		static void AlignEdge(Edge& edge) {
-			if (edge.first > edge.second) {
-				std::swap(edge.first, edge.second);
+		// calls sink(points, count, isClosed) for each path in turn, with a pointer to its
+		// points that is only valid during the call. the tolerance is as for the paths above
+		template <typename Sink>
+		void Intersect(const Plane& plane, Workspace& workspace, const Sink& sink,
+			const size_t threadCount = 1, const FloatType tolerance = 0) const {
+			const Mesh mesh(Current());
+			_Execute(mesh, plane, false, threadCount, workspace);
+			{
+				StepTimer timer(workspace.statistics.pathSeconds);
+				StreamPaths(mesh, plane, workspace, sink, tolerance);
 			}
+			FinishStatistics(workspace);
 		}
 
-		static EdgePath GetEdgePath(CrossingFaceMap& crossingFaces) {
-			auto currentFace = crossingFaces.cbegin();
-			EdgePath edgePath({ currentFace->first });
-			int closingVertex(currentFace->second);
-			while (GetNextPoint(currentFace, crossingFaces)) {
-				edgePath.push_back(currentFace->first);
-				closingVertex = currentFace->second;
+		template <typename Sink>
+		void Clip(const Plane& plane, Workspace& workspace, const Sink& sink,
+			const size_t threadCount = 1, const FloatType tolerance = 0) const {
+			const Mesh mesh(Current());
+			_Execute(mesh, plane, true, threadCount, workspace);
+			{
+				StepTimer timer(workspace.statistics.pathSeconds);
+				StreamPaths(mesh, plane, workspace, sink, tolerance);
 			}
-			edgePath.push_back({ edgePath.back().second, closingVertex });
-			for (auto& edge : edgePath) {
-				AlignEdge(edge);
+			FinishStatistics(workspace);
+		}
+
+		// the paths as edge points, replacing what was in result. no positions are worked
+		// out, so this is all that is needed for the layout of the paths, and Interpolate
+		// then gives whichever values are wanted at the points
+		void Intersect(const Plane& plane, Workspace& workspace, SymbolicPaths& result,
+			const size_t threadCount = 1) const {
+			const Mesh mesh(Current());
+			_Execute(mesh, plane, false, threadCount, workspace);
+			{
+				StepTimer timer(workspace.statistics.pathSeconds);
+				ConstructSymbolicPaths(workspace.chainedPaths, workspace.vertexOffsets, threadCount,
+					result);
 			}
-			return edgePath;
+			FinishStatistics(workspace);
 		}
 
-		static bool GetNextPoint(CrossingFaceMap::const_iterator& currentFace,
-			CrossingFaceMap& crossingFaces) {
-			auto nextKey(std::make_pair(currentFace->first.second, currentFace->second));
-			crossingFaces.erase(currentFace);
-			currentFace = crossingFaces.find(nextKey);
-			if (currentFace == crossingFaces.end()) {
-				std::swap(nextKey.first, nextKey.second);
-				currentFace = crossingFaces.find(nextKey);
+		void Clip(const Plane& plane, Workspace& workspace, SymbolicPaths& result,
+			const size_t threadCount = 1) const {
+			const Mesh mesh(Current());
+			_Execute(mesh, plane, true, threadCount, workspace);
+			{
+				StepTimer timer(workspace.statistics.pathSeconds);
+				ConstructSymbolicPaths(workspace.chainedPaths, workspace.vertexOffsets, threadCount,
+					result);
 			}
-			return currentFace != crossingFaces.end();
+			FinishStatistics(workspace);
 		}
 
-		template <typename Type>
-		static bool GetStartingItem(const std::vector<Type>& items,
-			std::vector<bool>& usedItems, Type& startItem) {
-			for (size_t i(0); i < items.size(); ++i) {
-				if (!usedItems[i]) {
-					startItem = items[i];
-					usedItems[i] = true;
-					return true;
+		// works out each of the attributes at every point of the paths, in one pass over
+		// the points. the point values of each attribute need room for paths.points.size()
+		// times its width. interpolating the vertex positions, with a width of 3, gives
+		// the same points as Intersect and Clip with a Plane
+		static void Interpolate(const SymbolicPaths& paths, const std::vector<Attribute>& attributes,
+			const size_t threadCount = 1) {
+			ParallelFor(threadCount, paths.points.size(), 1, [&](size_t, size_t begin, size_t end) {
+				for (size_t iPoint(begin); iPoint < end; ++iPoint) {
+					const auto& point(paths.points[iPoint]);
+					const FloatType factor(point.factor);
+					for (const auto& attribute : attributes) {
+						const size_t width(attribute.width);
+						const FloatType* first(attribute.vertexValues + point.first * width);
+						const FloatType* second(attribute.vertexValues + point.second * width);
+						FloatType* values(attribute.pointValues + iPoint * width);
+						for (size_t i(0); i < width; ++i) {
+							values[i] = first[i] + (second[i] - first[i]) * factor;
+						}
+					}
 				}
+			});
+		}
+
+		// the area properties of each closed path of the intersection, in path order, and
+		// of all of them together. the integrals are added up as the paths are traced, so
+		// no points are stored. open paths have no area and are left out
+		void IntersectProperties(const Plane& plane, Workspace& workspace,
+			std::vector<AreaProperties>& loops, AreaProperties& total,
+			const size_t threadCount = 1) const {
+			const Mesh mesh(Current());
+			_Execute(mesh, plane, false, threadCount, workspace);
+			{
+				StepTimer timer(workspace.statistics.pathSeconds);
+				ConstructProperties(mesh, plane, workspace, threadCount, loops, total);
 			}
-			return false;
+			FinishStatistics(workspace);
 		}
 
-		static bool InsertConnectingEdgePath(const std::vector<EdgePath>& edgePaths,
-			std::vector<bool>& usedPaths, EdgePath& currentChain) {
-			int iPath(-1);
-			for (auto& path : edgePaths) {
-				++iPath;
-				if (usedPaths[iPath]) {
-					continue;
-				}
-				if (path.front() == currentChain.back())
-					currentChain.insert(currentChain.end(), path.begin() + 1, path.end());
-				else if (path.back() == currentChain.back())
-					currentChain.insert(currentChain.end(), path.rbegin() + 1, path.rend());
-				else if (path.back() == currentChain.front())
-					currentChain.insert(currentChain.begin(), path.begin(), path.end() - 1);
-				else if (path.front() == currentChain.front())
-					currentChain.insert(currentChain.begin(), path.rbegin(), path.rend() - 1);
-				else continue;
-
-				usedPaths[iPath] = true;
-				return true;
+		AreaProperties IntersectProperties(const Plane& plane, const size_t threadCount = 1) const {
+			Workspace workspace;
+			std::vector<AreaProperties> loops;
+			AreaProperties total;
+			IntersectProperties(plane, workspace, loops, total, threadCount);
+			return total;
+		}
+
+		// the closed paths of the intersection in the coordinates of PlaneFrame(plane), in
+		// path order, with which loops are inside which. open paths are left out. the
+		// polygons already in result are written over
+		void IntersectPolygons(const Plane& plane, Workspace& workspace,
+			std::vector<Polygon2D>& result, const size_t threadCount = 1) const {
+			const Mesh mesh(Current());
+			_Execute(mesh, plane, false, threadCount, workspace);
+			{
+				StepTimer timer(workspace.statistics.pathSeconds);
+				ConstructPolygons(mesh, plane, workspace, threadCount, result);
 			}
-			return false;
+			FinishStatistics(workspace);
 		}
 
-		static void ChainEdgePaths(std::vector<EdgePath>& edgePaths) {
-			if (edgePaths.size() < 1) {
-				return;
+		std::vector<Polygon2D> IntersectPolygons(const Plane& plane,
+			const size_t threadCount = 1) const {
+			Workspace workspace;
+			std::vector<Polygon2D> result;
+			IntersectPolygons(plane, workspace, result, threadCount);
+			return result;
+		}
+
+		// cuts the mesh into the parts above and below the plane in one pass. the faces
+		// crossing the plane are cut in three, and each edge crossing it gives one new
+		// vertex used by the faces on both sides of it. with isCapped the closed paths of
+		// the intersection are triangulated as well, facing out of each part, so a closed
+		// mesh is cut into closed parts. vertices on the plane go with the part above, and
+		// the faces left with no area by them are dropped. the parts already in above and
+		// below are written over
+		void Split(const Plane& plane, Workspace& workspace, IndexedMesh& above, IndexedMesh& below,
+			const bool isCapped = true, const size_t threadCount = 1) const {
+			_Split(Current(), plane, isCapped, threadCount, workspace, above, below);
+		}
+
+		// the part above the plane and the part below it
+		std::pair<IndexedMesh, IndexedMesh> Split(const Plane& plane, const bool isCapped = true,
+			const size_t threadCount = 1) const {
+			Workspace workspace;
+			std::pair<IndexedMesh, IndexedMesh> parts;
+			Split(plane, workspace, parts.first, parts.second, isCapped, threadCount);
+			return parts;
+		}
+
+		// intersects the mesh with a stack of 'count' parallel planes sharing the same
+		// normal, the first at 'firstOffset' along the normal and then every 'spacing'.
+		// the result holds one set of paths per layer
+		std::vector<std::vector<Path3D>> Slice(const Vec3D& normal, const FloatType firstOffset,
+			const FloatType spacing, const size_t count) const {
+			std::vector<FloatType> offsets;
+			offsets.reserve(count);
+			for (size_t i(0); i < count; ++i) {
+				offsets.push_back(firstOffset + spacing * static_cast<FloatType>(i));
 			}
-			std::vector<bool> usedPaths(edgePaths.size());
-			std::vector<EdgePath> chainedPaths;
-			EdgePath chain;
-			while (GetStartingItem(edgePaths, usedPaths, chain)) {
-				while (InsertConnectingEdgePath(edgePaths, usedPaths, chain)) {}
-				chainedPaths.push_back(chain);
+			return Slice(normal, offsets);
+		}
+
+		// layer i is the plane through normal * offsets[i], so each layer gives the same
+		// result as calling Intersect with SlicePlane(normal, offsets[i])
+		std::vector<std::vector<Path3D>> Slice(const Vec3D& normal,
+			const std::vector<FloatType>& offsets) const {
+			return _Slice(Current(), normal, offsets);
+		}
+
+		class SliceJob;
+
+		// the same as Slice, but on a thread of its own so that this one can carry on.
+		// onLayer(iLayer, paths) is called on the job's thread as each layer is finished,
+		// in order of increasing offset, so the first layers can be used while the rest
+		// are worked out. the vertices and faces have to outlive the job
+		SliceJob SliceAsync(const Vec3D& normal, const std::vector<FloatType>& offsets,
+			std::function<void(size_t, const std::vector<Path3D>&)> onLayer = nullptr) const {
+			return SliceJob(Current(), normal, offsets, std::move(onLayer));
+		}
+
+		// intersects the mesh with each of the planes, which may be at any angle. the planes
+		// are shared out over threadCount threads and result i is the same as
+		// Intersect(planes[i]). what only depends on the mesh is worked out once for all
+		// of them, see _Planes
+		std::vector<std::vector<Path3D>> IntersectPlanes(const std::vector<Plane>& planes,
+			const size_t threadCount = 1) const {
+			return _Planes(Current(), planes, false, threadCount);
+		}
+
+		std::vector<std::vector<Path3D>> ClipPlanes(const std::vector<Plane>& planes,
+			const size_t threadCount = 1) const {
+			return _Planes(Current(), planes, true, threadCount);
+		}
+
+		static Plane SlicePlane(const Vec3D& normal, const FloatType offset) {
+			Plane plane;
+			plane.normal = normal;
+			for (int i(0); i < 3; ++i) {
+				plane.origin[i] = normal[i] * offset;
 			}
-			edgePaths = chainedPaths;
+			return plane;
 		}
 
-		static std::vector<Edge> FreeEdges(const std::vector<Face>& faces,
-			const std::vector<FloatType>& vertexOffsets) {
-			std::map<Edge, int> edgeFaceCount;
-			for (const auto& face : faces) {
-				for (int iEdge(0); iEdge < 3; ++iEdge) {
-					const auto& v0(face[iEdge]);
-					const auto& v1(face[(iEdge + 1) % 3]);
-					if (vertexOffsets[v0] < 0 && vertexOffsets[v1] < 0) {
-						continue;
-					}
-					Edge thisEdge(v0, v1);
-					AlignEdge(thisEdge);
-					edgeFaceCount[thisEdge]++;
-				}
+		// intersects a mesh that is read from source a chunk of faces at a time, for meshes
+		// too large to hold in memory. only the current chunk and the faces crossing the
+		// plane are kept, and the paths are traced through these at the end, giving the
+		// same result as Intersect on the whole mesh. the source needs the methods
+		//   size_t FaceCount() const
+		//   void ReadFaces(size_t first, size_t count, Face* faces) const
+		//   Vec3D ReadVertex(size_t index) const
+		// such as those of MappedMeshFile
+		template <typename Source>
+		static std::vector<Path3D> IntersectStream(const Source& source, const Plane& plane,
+			const size_t chunkSize = 1 << 16) {
+			return _IntersectStream(source, plane, std::max<size_t>(1, chunkSize));
+		}
+
+		// builds the face adjacency and the free edges once, so that later queries walk
+		// contours from face to face instead of searching for the next crossing face, and
+		// Clip doesn't have to find the free edges again. only worthwhile when the same
+		// mesh is intersected more than once
+		void BuildTopology() {
+			topology = FaceTopology(Current().faces, 1);
+		}
+
+		// keeps a copy of the vertex coordinates as separate x, y and z arrays, which
+		// lets the vertex offsets be computed several vertices at a time. useful for
+		// large meshes that are intersected more than once
+		void BuildVertexArrays() {
+			const ArrayView<Vec3D> vertices(Current().vertices);
+			auto coordinates(std::make_shared<std::array<std::vector<FloatType>, 3>>());
+			for (int i(0); i < 3; ++i) {
+				(*coordinates)[i].reserve(vertices.size());
 			}
-			std::vector<Edge> freeEdges;
-			for (const auto& edge : edgeFaceCount) {
-				if (edge.second == 1) {
-					freeEdges.push_back(edge.first);
+			for (const auto& vertex : vertices) {
+				for (int i(0); i < 3; ++i) {
+					(*coordinates)[i].push_back(vertex[i]);
 				}
 			}
-			return freeEdges;
+			auto arrays(std::make_shared<VertexArrays>());
+			for (int i(0); i < 3; ++i) {
+				arrays->coordinates[i] = (*coordinates)[i];
+			}
+			arrays->storage = coordinates;
+			vertexArrays = arrays;
 		}
 
-		struct FreeEdgePath {
-			Edge StartEdge, EndEdge;
-			std::vector<int> vertices;
-			bool isUsed = false;
-		};
-		static std::vector<EdgePath> FreeEdgePaths(const std::vector<Edge>& freeEdges,
-			const std::vector<FloatType> vertexOffsets) {
-			std::vector<EdgePath> freeEdgePaths;
-			std::vector<bool> usedEdges(freeEdges.size());
-			Edge edge;
-			while (GetStartingItem(freeEdges, usedEdges, edge)) {
-				FreeEdgePath path;
-				path.StartEdge = path.EndEdge = Edge(-1, -1);
+		// builds a bounding box hierarchy over the faces, so that queries skip the parts
+		// of the mesh well away from the plane and only compute the offsets of vertices
+		// on faces near it. worthwhile for large meshes where planes cut few faces
+		void BuildFaceHierarchy() {
+			const Mesh mesh(Current());
+			faceHierarchy = BoundingHierarchy(mesh.vertices, mesh.faces);
+		}
 
-				if (vertexOffsets[edge.first] > 0) {
-					path.vertices.push_back(edge.first);
-					if (vertexOffsets[edge.second] < 0) {
-						path.StartEdge = edge;
-					}
+		// renumbers the vertices along a Morton curve through their bounding box, and
+		// sorts the faces by their lowest new vertex number, so that vertices and faces
+		// close together in space are close together in memory. call this before making
+		// the mesh, as it refers to the arrays. vertexOrder[i] and faceOrder[i] are the
+		// old numbers of new vertex i and new face i, for carrying across values stored
+		// per vertex or per face. the paths are the same apart from where they start and
+		// the order they come in
+		static void Reorder(std::vector<Vec3D>& vertices, std::vector<Face>& faces,
+			std::vector<IndexType>& vertexOrder, std::vector<IndexType>& faceOrder,
+			const size_t threadCount = 1) {
+			Vec3D lower(vertices.empty() ? Vec3D{ 0, 0, 0 } : vertices[0]), upper(lower);
+			for (const auto& vertex : vertices) {
+				for (int i(0); i < 3; ++i) {
+					lower[i] = std::min(lower[i], vertex[i]);
+					upper[i] = std::max(upper[i], vertex[i]);
 				}
-				if (vertexOffsets[edge.second] > 0) {
-					path.vertices.push_back(edge.second);
-					if (vertexOffsets[edge.first] < 0) {
-						path.EndEdge = edge;
+			}
+			Vec3D scale;
+			for (int i(0); i < 3; ++i) {
+				scale[i] = upper[i] > lower[i] ? FloatType(mortonCells - 1) / (upper[i] - lower[i]) : 0;
+			}
+
+			std::vector<std::pair<std::uint64_t, Index>> vertexKeys(vertices.size());
+			ParallelFor(threadCount, vertices.size(), 1 << 14, [&](size_t, size_t begin, size_t end) {
+				for (size_t iVertex(begin); iVertex < end; ++iVertex) {
+					std::uint64_t code(0);
+					for (int i(0); i < 3; ++i) {
+						code |= SpreadBits(static_cast<std::uint64_t>(
+							(vertices[iVertex][i] - lower[i]) * scale[i])) << i;
 					}
+					vertexKeys[iVertex] = { code, static_cast<Index>(iVertex) };
 				}
-				while (ExtendFreeEdgePath(path, freeEdges, usedEdges, vertexOffsets)) {
-					// chain getting longer, available edges getting smaller
+			});
+			ParallelSort(vertexKeys, threadCount, std::less<std::pair<std::uint64_t, Index>>());
+
+			std::vector<Index> newVertex(vertices.size());
+			std::vector<Vec3D> sortedVertices(vertices.size());
+			vertexOrder.resize(vertices.size());
+			for (size_t i(0); i < vertices.size(); ++i) {
+				newVertex[vertexKeys[i].second] = static_cast<Index>(i);
+				sortedVertices[i] = vertices[vertexKeys[i].second];
+				vertexOrder[i] = static_cast<IndexType>(vertexKeys[i].second);
+			}
+			vertices.swap(sortedVertices);
+
+			std::vector<std::pair<Index, Index>> faceKeys(faces.size());
+			ParallelFor(threadCount, faces.size(), 1 << 14, [&](size_t, size_t begin, size_t end) {
+				for (size_t iFace(begin); iFace < end; ++iFace) {
+					Index lowest(std::numeric_limits<Index>::max());
+					for (int i(0); i < 3; ++i) {
+						faces[iFace][i] = static_cast<IndexType>(newVertex[faces[iFace][i]]);
+						lowest = std::min(lowest, static_cast<Index>(faces[iFace][i]));
+					}
+					faceKeys[iFace] = { lowest, static_cast<Index>(iFace) };
 				}
-				EdgePath edgePath;
-				if (path.StartEdge.first >= 0) {
-					edgePath.push_back(path.StartEdge);
+			});
+			ParallelSort(faceKeys, threadCount, std::less<std::pair<Index, Index>>());
+
+			std::vector<Face> sortedFaces(faces.size());
+			faceOrder.resize(faces.size());
+			for (size_t i(0); i < faces.size(); ++i) {
+				sortedFaces[i] = faces[faceKeys[i].second];
+				faceOrder[i] = static_cast<IndexType>(faceKeys[i].second);
+			}
+			faces.swap(sortedFaces);
+		}
+
+	private:
+		// set when the mesh was made from vectors, see Current
+		const std::vector<Vec3D>* vertexVector = nullptr;
+		const std::vector<Face>* faceVector = nullptr;
+		ArrayView<Vec3D> vertices;
+		ArrayView<Face> faces;
+
+		// the mesh with its views on what the vectors hold now. each query starts with this
+		// and works on the views from then on
+		Mesh Current() const {
+			Mesh mesh(*this);
+			if (vertexVector) {
+				mesh.vertices = *vertexVector;
+				mesh.faces = *faceVector;
+			}
+			return mesh;
+		}
+
+		// vertex, face and edge numbers, signed so that -1 can mark a missing one, and
+		// wide enough for every value of IndexType, so that unsigned 32 bit indices and
+		// meshes past 2^31 faces with 64 bit indices work
+		typedef typename std::conditional<(static_cast<std::uintmax_t>(
+			std::numeric_limits<IndexType>::max()) > static_cast<std::uintmax_t>(
+			std::numeric_limits<int>::max())), std::int64_t, int>::type Index;
+		typedef std::pair<Index, Index> Edge;
+		// half edge numbers are three per face, so they pass 2^31 long before the faces do
+		typedef std::int64_t HalfEdgeIndex;
+
+		// edges are looked up by a single 64 bit word when both vertex numbers fit in
+		// 32 bits, and by the pair itself otherwise
+		static constexpr bool isPackedKey = sizeof(Index) <= sizeof(std::uint32_t);
+		typedef typename std::conditional<isPackedKey, std::uint64_t, Edge>::type EdgeKey;
+
+		static EdgeKey Key(const Edge& edge) {
+			return Key(edge, std::integral_constant<bool, isPackedKey>());
+		}
+
+		static std::uint64_t Key(const Edge& edge, std::true_type) {
+			return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(edge.first)) << 32) |
+				static_cast<std::uint32_t>(edge.second);
+		}
+
+		static Edge Key(const Edge& edge, std::false_type) {
+			return edge;
+		}
+
+		struct EdgeHash {
+			size_t operator()(const std::uint64_t key) const {
+				return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32);
+			}
+
+			size_t operator()(const Edge& edge) const {
+				const std::uint64_t key((static_cast<std::uint64_t>(edge.first) * 0x9E3779B97F4A7C15ull) ^
+					static_cast<std::uint64_t>(edge.second));
+				return static_cast<size_t>((key * 0xC2B2AE3D27D4EB4Full) >> 32);
+			}
+		};
+
+		// paths of edges stored one after the other, path i running from edges[starts[i]]
+		// up to edges[starts[i + 1]], so that refilling them reuses the same memory
+		struct EdgePathList {
+			std::vector<Edge> edges;
+			std::vector<size_t> starts;
+		};
+
+		static size_t PathCount(const EdgePathList& paths) {
+			return paths.starts.empty() ? 0 : paths.starts.size() - 1;
+		}
+
+		static void ClearPaths(EdgePathList& paths) {
+			paths.edges.clear();
+			paths.starts.assign(1, 0);
+		}
+
+		// ends the path made of the edges added since the last one
+		static void EndPath(EdgePathList& paths) {
+			paths.starts.push_back(paths.edges.size());
+		}
+
+		// the free edges of the mesh, which belong to only one face, in edge order. the
+		// vertices on them are numbered in order, and the free edges at each of these
+		// are listed from vertexStarts[i] to vertexStarts[i + 1] of vertexEdges
+		struct FreeEdgeIndex {
+			std::vector<Edge> edges, edgeEnds;
+			std::vector<Index> vertices;
+			std::vector<size_t> vertexStarts;
+			std::vector<Index> vertexEdges;
+		};
+
+		// the same arrays, wherever they are held
+		struct FreeEdgeView {
+			FreeEdgeView() = default;
+			FreeEdgeView(const FreeEdgeIndex& index) :
+				edges(index.edges), edgeEnds(index.edgeEnds), vertices(index.vertices),
+				vertexStarts(index.vertexStarts), vertexEdges(index.vertexEdges) {}
+
+			ArrayView<Edge> edges, edgeEnds;
+			ArrayView<Index> vertices;
+			ArrayView<size_t> vertexStarts;
+			ArrayView<Index> vertexEdges;
+		};
+
+		// what is built for the mesh is held as views, so that it can also be mapped from
+		// a cache file, see MeshCacheFile.hpp. storage owns the arrays when they were
+		// built here, and is empty when they are mapped
+		struct Topology {
+			// the half edge from corner i to corner i + 1 of face f is 3 * f + i. this holds
+			// the matching half edge of the neighbouring face, or -1 for free edges and
+			// edges shared by more than two faces
+			ArrayView<HalfEdgeIndex> twins;
+			FreeEdgeView freeEdges;
+			std::shared_ptr<const void> storage;
+		};
+		std::shared_ptr<const Topology> topology;
+
+		struct VertexArrays {
+			std::array<ArrayView<FloatType>, 3> coordinates;
+			std::shared_ptr<const void> storage;
+		};
+		std::shared_ptr<const VertexArrays> vertexArrays;
+
+		// nodes are leaves holding faces[first] to faces[first + count - 1], or have
+		// count 0 and children nodes[first] and nodes[first + 1]
+		struct FaceHierarchy {
+			struct Node {
+				Vec3D min, max;
+				Index first, count;
+			};
+			ArrayView<Node> nodes;
+			ArrayView<Index> faces;
+			std::shared_ptr<const void> storage;
+		};
+		std::shared_ptr<const FaceHierarchy> faceHierarchy;
+
+		friend class MeshCacheFile<FloatType, IndexType>;
+		friend class MeshLoader<FloatType, IndexType>;
+
+		// a bit per vertex, in words of 64, for the vertices above and below the plane
+		struct VertexSigns {
+			std::vector<std::uint64_t> positive, negative;
+		};
+
+		// leaves the paths in workspace.chainedPaths. PlaneType is Plane or an AxisPlane
+		template <typename PlaneType>
+		static void _Execute(const Mesh& mesh, const PlaneType& plane, const bool isClip,
+			const size_t threadCount, Workspace& workspace) {
+			auto& vertexOffsets(workspace.vertexOffsets);
+			auto& statistics(workspace.statistics);
+			StartStatistics(workspace);
+			if (mesh.faceHierarchy) {
+				StepTimer timer(statistics.crossingFaceSeconds);
+				HierarchyCrossingFaces(mesh, plane, workspace);
+			}
+			else {
+				{
+					StepTimer timer(statistics.vertexOffsetSeconds);
+					VertexOffsets(mesh, plane, vertexOffsets, workspace.vertexSigns, threadCount);
 				}
-				for (const int iVert : path.vertices) {
-					edgePath.push_back(std::make_pair(iVert, iVert));
+				StepTimer timer(statistics.crossingFaceSeconds);
+				CrossingFaces(mesh.faces, threadCount, workspace);
+			}
+			Count(statistics.crossingFaces, workspace.crossingFaces.size());
+			CheckCancelled(workspace);
+			{
+				StepTimer timer(statistics.edgePathSeconds);
+				EdgePaths(mesh.topology.get(), mesh.faces.size(), threadCount, workspace);
+			}
+			Count(statistics.edgePaths, PathCount(workspace.edgePaths));
+			if (isClip) {
+				if (!mesh.topology) {
+					StepTimer timer(statistics.freeEdgeSeconds);
+					SortedHalfEdges(mesh.faces, threadCount, workspace.halfEdges);
+					IndexFreeEdges(workspace.halfEdges, workspace.freeEdges);
 				}
-				if (path.EndEdge.first >= 0) {
-					edgePath.push_back(path.EndEdge);
+				const FreeEdgeView freeEdges(mesh.topology ? mesh.topology->freeEdges :
+					FreeEdgeView(workspace.freeEdges));
+				Count(statistics.freeEdges, freeEdges.edges.size());
+				StepTimer timer(statistics.freeEdgePathSeconds);
+				if (mesh.faceHierarchy) {
+					for (const Index iVertex : freeEdges.vertices) {
+						vertexOffsets[iVertex] = VertexOffset(mesh.vertices[iVertex], plane);
+					}
 				}
-				freeEdgePaths.push_back(edgePath);
+				FreeEdgePaths(freeEdges, vertexOffsets, workspace);
+				CheckCancelled(workspace);
+			}
+			Count(statistics.freeEdgePaths, PathCount(workspace.edgePaths) - statistics.edgePaths);
+			{
+				StepTimer timer(statistics.chainSeconds);
+				ChainEdgePaths(workspace);
 			}
-			return freeEdgePaths;
+			Count(statistics.chainProbes, workspace.endpoints.probes);
+			Count(statistics.chainedPaths, PathCount(workspace.chainedPaths));
 		}
 
-		static bool ExtendFreeEdgePath(FreeEdgePath& path, const std::vector<Edge>& freeEdges,
-			std::vector<bool>& usedFreeEdges, const std::vector<FloatType> vertexOffsets) {
+		// adds the time from its construction to its destruction to seconds when statistics
+		// are recorded, and otherwise does nothing
+		class StepTimer {
+		public:
+#ifdef MESH_PLANE_INTERSECT_STATISTICS
+			explicit StepTimer(double& seconds) :
+				seconds(seconds), start(std::chrono::steady_clock::now()) {}
 
-			for (size_t iEdge(0); iEdge < freeEdges.size(); iEdge++) {
-				if (usedFreeEdges[iEdge]) {
-					continue;
-				}
-				const auto& edge(freeEdges[iEdge]);
-				const bool edgeCrosses = vertexOffsets[edge.first] * vertexOffsets[edge.second] < 0;
+			~StepTimer() {
+				seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			}
 
-				// try adding to the back of the chain
-				if (path.EndEdge.first == -1) {
-					const bool append(path.vertices.back() == edge.first);
-					const bool appendReverse(path.vertices.back() == edge.second);
-					if (append || appendReverse) {
-						if (edgeCrosses) {
-							path.EndEdge = edge;
-						}
-						else {
-							path.vertices.push_back(append ? edge.second : edge.first);
-						}
-						usedFreeEdges[iEdge] = true;
-						return true;
+		private:
+			double& seconds;
+			const std::chrono::steady_clock::time_point start;
+#else
+			explicit StepTimer(double&) {}
+#endif
+		};
+
+		static void Count(size_t& counter, const size_t count) {
+#ifdef MESH_PLANE_INTERSECT_STATISTICS
+			counter += count;
+#else
+			(void)counter;
+			(void)count;
+#endif
+		}
+
+		static bool IsCancelled(const Workspace& workspace) {
+			return workspace.cancelFlag && workspace.cancelFlag->load(std::memory_order_relaxed);
+		}
+
+		static void CheckCancelled(const Workspace& workspace) {
+			if (IsCancelled(workspace)) {
+				throw Cancelled();
+			}
+		}
+
+		static void StartStatistics(Workspace& workspace) {
+#ifdef MESH_PLANE_INTERSECT_STATISTICS
+			workspace.statistics = Statistics();
+			workspace.statistics.workspaceGrowthBytes = WorkspaceBytes(workspace);
+#else
+			(void)workspace;
+#endif
+		}
+
+		static void FinishStatistics(Workspace& workspace) {
+#ifdef MESH_PLANE_INTERSECT_STATISTICS
+			auto& statistics(workspace.statistics);
+			statistics.workspaceBytes = WorkspaceBytes(workspace);
+			statistics.workspaceGrowthBytes = statistics.workspaceBytes -
+				std::min(statistics.workspaceBytes, statistics.workspaceGrowthBytes);
+			if (workspace.statisticsHook) {
+				workspace.statisticsHook(statistics);
+			}
+#else
+			(void)workspace;
+#endif
+		}
+
+#ifdef MESH_PLANE_INTERSECT_STATISTICS
+		template <typename Type>
+		static size_t Bytes(const std::vector<Type>& items) {
+			return items.capacity() * sizeof(Type);
+		}
+
+		static size_t Bytes(const std::vector<bool>& items) {
+			return items.capacity() / 8;
+		}
+
+		template <typename Type>
+		static size_t Bytes(const std::vector<std::vector<Type>>& lists) {
+			size_t bytes(lists.capacity() * sizeof(std::vector<Type>));
+			for (const auto& items : lists) {
+				bytes += Bytes(items);
+			}
+			return bytes;
+		}
+
+		static size_t WorkspaceBytes(const Workspace& workspace) {
+			const auto& w(workspace);
+			return Bytes(w.vertexOffsets) + Bytes(w.vertexSigns.positive) +
+				Bytes(w.vertexSigns.negative) + Bytes(w.crossingFaces) +
+				Bytes(w.crossingFaceChunks) + Bytes(w.faceCrossings) + Bytes(w.candidateFaces) +
+				Bytes(w.nodeStack) + Bytes(w.edgePaths.edges) + Bytes(w.edgePaths.starts) +
+				Bytes(w.chainedPaths.edges) + Bytes(w.chainedPaths.starts) +
+				Bytes(w.endpoints.table) + Bytes(w.endpoints.slotKeys) +
+				Bytes(w.endpoints.slotStarts) + Bytes(w.endpoints.slotCursors) +
+				Bytes(w.endpoints.paths) + Bytes(w.endpoints.pathSlots) + Bytes(w.usedPaths) +
+				Bytes(w.chain.frontLinks) + Bytes(w.chain.backLinks) + Bytes(w.halfEdges) +
+				Bytes(w.freeEdges.edges) + Bytes(w.freeEdges.edgeEnds) +
+				Bytes(w.freeEdges.vertices) + Bytes(w.freeEdges.vertexStarts) +
+				Bytes(w.freeEdges.vertexEdges) + Bytes(w.usedEdges) + Bytes(w.vertexCursors) +
+				Bytes(w.freeEdgePath.frontVertices) + Bytes(w.freeEdgePath.backVertices) +
+				Bytes(w.pathPoints) + Bytes(w.areaIntegrals) + Bytes(w.closedPaths) +
+				Bytes(w.polygonBounds) + Bytes(w.queryPoints) + Bytes(w.polygonOrder) +
+				Bytes(w.polygonQueries) + Bytes(w.activePolygons) + Bytes(w.candidatePolygons) +
+				Bytes(w.cutKeys) + Bytes(w.cutPoints) + Bytes(w.partNumbers[0]) +
+				Bytes(w.partNumbers[1]) + Bytes(w.cutNumbers[0]) + Bytes(w.cutNumbers[1]) +
+				Bytes(w.capPolygons) + Bytes(w.capLoops) + Bytes(w.capRing) + Bytes(w.capLinks) +
+				Bytes(w.capBridge) + Bytes(w.cutCoordinates);
+		}
+#endif
+
+		// calls function(chunk, begin, end) for up to threadCount chunks of [0, count),
+		// each starting on a multiple of granularity. the first chunk runs on this thread
+		template <typename Function>
+		static void ParallelFor(const size_t threadCount, const size_t count,
+			const size_t granularity, const Function& function) {
+			const size_t units((count + granularity - 1) / granularity);
+			const size_t chunkCount(std::max<size_t>(1, std::min(threadCount, units)));
+			const auto chunkStart = [&](const size_t iChunk) {
+				return std::min(count, units * iChunk / chunkCount * granularity);
+			};
+			if (chunkCount == 1) {
+				function(0, 0, count);
+				return;
+			}
+			std::vector<std::thread> threads;
+			std::vector<std::exception_ptr> exceptions(chunkCount);
+			threads.reserve(chunkCount - 1);
+			for (size_t iChunk(1); iChunk < chunkCount; ++iChunk) {
+				threads.emplace_back([&, iChunk]() {
+					try {
+						function(iChunk, chunkStart(iChunk), chunkStart(iChunk + 1));
 					}
+					catch (...) {
+						exceptions[iChunk] = std::current_exception();
+					}
+				});
+			}
+			try {
+				function(0, 0, chunkStart(1));
+			}
+			catch (...) {
+				exceptions[0] = std::current_exception();
+			}
+			for (auto& thread : threads) {
+				thread.join();
+			}
+			for (const auto& exception : exceptions) {
+				if (exception) {
+					std::rethrow_exception(exception);
 				}
-				// try adding to the front of the chain
-				if (path.StartEdge.first == -1) {
-					const bool prepend(path.vertices.front() == edge.first);
-					const bool prependReverse(path.vertices.front() == edge.second);
-					if (prepend || prependReverse) {
-						if (edgeCrosses) {
-							path.StartEdge = edge;
+			}
+		}
+
+		// calls function(worker, i) for each i in [0, count) on up to threadCount workers.
+		// each worker starts on its own share of the items, and once that is done takes
+		// half of what is left of the largest share, so that items taking different times
+		// still keep every thread busy. the shares are numbered in 32 bits, so larger
+		// counts are worked through in blocks of up to 2^32 - 1 items, one after another
+		template <typename Function>
+		static void StealingFor(const size_t threadCount, const size_t count,
+			const Function& function) {
+			const std::uint64_t blockSize(0xFFFFFFFF);
+			for (std::uint64_t first(0); first < count; first += blockSize) {
+				const size_t blockCount(static_cast<size_t>(std::min<std::uint64_t>(blockSize,
+					count - first)));
+				const size_t offset(static_cast<size_t>(first));
+				StealingBlock(threadCount, blockCount, [&function, offset](size_t worker, size_t i) {
+					function(worker, offset + i);
+				});
+			}
+		}
+
+		// StealingFor over a count that fits in 32 bits
+		template <typename Function>
+		static void StealingBlock(const size_t threadCount, const size_t count,
+			const Function& function) {
+			const size_t workerCount(std::max<size_t>(1, std::min(threadCount, count)));
+			// a share runs from front up to back, packed into one word so that the owner
+			// can take from the front while others take from the back
+			const auto pack = [](const std::uint64_t front, const std::uint64_t back) {
+				return front << 32 | back;
+			};
+			std::vector<std::atomic<std::uint64_t>> shares(workerCount);
+			for (size_t i(0); i < workerCount; ++i) {
+				shares[i] = pack(count * i / workerCount, count * (i + 1) / workerCount);
+			}
+			ParallelFor(workerCount, workerCount, 1, [&](size_t worker, size_t, size_t) {
+				auto& own(shares[worker]);
+				for (;;) {
+					std::uint64_t share(own.load());
+					while ((share >> 32) < (share & 0xFFFFFFFF) &&
+						!own.compare_exchange_weak(share, share + (std::uint64_t(1) << 32))) {}
+					if ((share >> 32) < (share & 0xFFFFFFFF)) {
+						function(worker, static_cast<size_t>(share >> 32));
+						continue;
+					}
+					// nothing left here, so take the back half of the largest share
+					bool isStolen(false);
+					while (!isStolen) {
+						size_t victim(workerCount);
+						std::uint64_t victimShare(0), largest(0);
+						for (size_t i(0); i < workerCount; ++i) {
+							const std::uint64_t other(shares[i].load());
+							const std::uint64_t front(other >> 32), back(other & 0xFFFFFFFF);
+							if (front < back && back - front > largest) {
+								victim = i;
+								victimShare = other;
+								largest = back - front;
+							}
 						}
-						else {
-							path.vertices.insert(path.vertices.begin(),
-								prepend ? edge.second : edge.first);
+						if (victim == workerCount) {
+							return;
+						}
+						const std::uint64_t back(victimShare & 0xFFFFFFFF);
+						const std::uint64_t taken((largest + 1) / 2);
+						if (shares[victim].compare_exchange_strong(victimShare,
+							pack(victimShare >> 32, back - taken))) {
+							own = pack(back - taken, back);
+							isStolen = true;
 						}
-						usedFreeEdges[iEdge] = true;
-						return true;
 					}
 				}
-			}
-			return false;
+			});
 		}
+
+		// sorts chunks on separate threads, then merges pairs of them until one is left.
+		// no two items may compare equal, as their order would depend on the thread count.
+		// on one thread nothing is allocated
+		template <typename Type, typename Compare>
+		static void ParallelSort(std::vector<Type>& items, const size_t threadCount,
+			const Compare& compare) {
+			const size_t chunkCount(std::min(threadCount, items.size() / 1024));
+			if (chunkCount < 2) {
+				std::sort(items.begin(), items.end(), compare);
+				return;
+			}
+			const auto chunkStart = [&](const size_t iChunk) {
+				return items.begin() + std::min(items.size(), items.size() * iChunk / chunkCount);
+			};
+			ParallelFor(chunkCount, chunkCount, 1, [&](size_t, size_t begin, size_t end) {
+				for (size_t iChunk(begin); iChunk < end; ++iChunk) {
+					std::sort(chunkStart(iChunk), chunkStart(iChunk + 1), compare);
+				}
+			});
+			for (size_t width(1); width < chunkCount; width *= 2) {
+				const size_t mergeCount((chunkCount + 2 * width - 1) / (2 * width));
+				ParallelFor(threadCount, mergeCount, 1, [&](size_t, size_t begin, size_t end) {
+					for (size_t iMerge(begin); iMerge < end; ++iMerge) {
+						const size_t iChunk(iMerge * 2 * width);
+						if (iChunk + width < chunkCount) {
+							std::inplace_merge(chunkStart(iChunk), chunkStart(iChunk + width),
+								chunkStart(std::min(chunkCount, iChunk + 2 * width)), compare);
+						}
+					}
+				});
+			}
+		}
+
+		// the planes share a copy of the mesh, which is cheap as it refers to the same
+		// vertices and faces, holding what is built for them. Clip needs the free edges,
+		// which come with the topology, and the vertex arrays cost about as much to build
+		// as the offsets of a plane or two, so they are built for more than a few planes.
+		// each worker keeps its own workspace
+		static std::vector<std::vector<Path3D>> _Planes(const Mesh& mesh,
+			const std::vector<Plane>& planes, const bool isClip, const size_t threadCount) {
+			Mesh prepared(mesh);
+			if (isClip && !prepared.topology && planes.size() > 1) {
+				prepared.topology = FaceTopology(mesh.faces, threadCount);
+			}
+			if (!prepared.vertexArrays && planes.size() >= 8) {
+				prepared.BuildVertexArrays();
+			}
+			std::vector<std::vector<Path3D>> results(planes.size());
+			std::vector<Workspace> workspaces(std::max<size_t>(1, std::min(threadCount, planes.size())));
+			StealingFor(threadCount, planes.size(), [&](size_t worker, size_t iPlane) {
+				auto& workspace(workspaces[worker]);
+				_Execute(prepared, planes[iPlane], isClip, 1, workspace);
+				ConstructGeometricPaths(prepared, planes[iPlane], workspace.chainedPaths,
+					workspace.vertexOffsets, 1, results[iPlane]);
+			});
+			return results;
+		}
+
+		// sweeping the layers in ascending order passes the section over each face once
+		static std::vector<std::vector<Path3D>> _Slice(const Mesh& mesh, const Vec3D& normal,
+			const std::vector<FloatType>& offsets, const std::atomic<bool>* cancelFlag = nullptr,
+			const std::function<void(size_t, const std::vector<Path3D>&)>& onLayer = nullptr) {
+			std::vector<std::vector<Path3D>> layers(offsets.size());
+			Section section(mesh, normal);
+			section.SetCancelFlag(cancelFlag);
+			std::vector<size_t> layerOrder(offsets.size());
+			for (size_t i(0); i < layerOrder.size(); ++i) {
+				layerOrder[i] = i;
+			}
+			std::sort(layerOrder.begin(), layerOrder.end(), [&offsets](size_t a, size_t b) {
+				return offsets[a] < offsets[b];
+			});
+			for (const auto iLayer : layerOrder) {
+				section.Intersect(offsets[iLayer], layers[iLayer]);
+				if (onLayer) {
+					onLayer(iLayer, layers[iLayer]);
+				}
+			}
+			return layers;
+		}
+
+		// a vertex of a face crossing the plane, kept for tracing the paths once the whole
+		// mesh has been read
+		struct BandVertex {
+			IndexType index;
+			Vec3D position;
+			FloatType offset;
+		};
+
+		template <typename Source>
+		static std::vector<Path3D> _IntersectStream(const Source& source, const Plane& plane,
+			const size_t chunkSize) {
+			Workspace workspace;
+			auto& crossingFaces(workspace.crossingFaces);
+			std::vector<Face> chunk, chunkFaces;
+			std::vector<IndexType> chunkVertices;
+			VertexSigns chunkSigns;
+			std::vector<FloatType> chunkOffsets;
+			std::vector<BandVertex> bandVertices;
+			const size_t faceCount(source.FaceCount());
+			for (size_t first(0); first < faceCount; first += chunkSize) {
+				chunk.resize(std::min(chunkSize, faceCount - first));
+				source.ReadFaces(first, chunk.size(), chunk.data());
+
+				// the faces are classified with their vertices numbered within the chunk
+				chunkVertices.clear();
+				for (const auto& face : chunk) {
+					chunkVertices.insert(chunkVertices.end(), face.begin(), face.end());
+				}
+				std::sort(chunkVertices.begin(), chunkVertices.end());
+				chunkVertices.erase(std::unique(chunkVertices.begin(), chunkVertices.end()),
+					chunkVertices.end());
+				chunkOffsets.resize(chunkVertices.size());
+				chunkSigns.positive.resize((chunkVertices.size() + 63) / 64);
+				chunkSigns.negative.resize(chunkSigns.positive.size());
+				for (size_t i(0); i < chunkVertices.size(); ++i) {
+					chunkOffsets[i] = VertexOffset(source.ReadVertex(chunkVertices[i]), plane);
+					SetVertexSign(chunkSigns, i, chunkOffsets[i]);
+				}
+				chunkFaces.resize(chunk.size());
+				for (size_t iFace(0); iFace < chunk.size(); ++iFace) {
+					for (int i(0); i < 3; ++i) {
+						chunkFaces[iFace][i] = static_cast<IndexType>(std::lower_bound(
+							chunkVertices.begin(), chunkVertices.end(), chunk[iFace][i]) -
+							chunkVertices.begin());
+					}
+				}
+
+				// the crossing faces are kept with the mesh vertex numbers
+				const size_t chunkStart(crossingFaces.size());
+				for (size_t iFace(0); iFace < chunk.size(); ++iFace) {
+					AddCrossingFace(chunkFaces, iFace, chunkSigns, crossingFaces);
+				}
+				for (size_t i(chunkStart); i < crossingFaces.size(); ++i) {
+					auto& crossingFace(crossingFaces[i]);
+					const auto& face(chunkFaces[crossingFace.face]);
+					for (const auto& iVertex : face) {
+						bandVertices.push_back({ chunkVertices[iVertex],
+							source.ReadVertex(chunkVertices[iVertex]), chunkOffsets[iVertex] });
+					}
+					crossingFace.key = { static_cast<Index>(chunkVertices[crossingFace.key.first]),
+						static_cast<Index>(chunkVertices[crossingFace.key.second]) };
+					crossingFace.closingVertex = static_cast<Index>(chunkVertices[crossingFace.closingVertex]);
+					crossingFace.face += static_cast<Index>(first);
+				}
+			}
+
+			// the band vertices are numbered in the same order as in the mesh, so the faces
+			// sort and join up exactly as they would have with the whole mesh
+			std::sort(bandVertices.begin(), bandVertices.end(),
+				[](const BandVertex& a, const BandVertex& b) {
+					return a.index < b.index;
+				});
+			bandVertices.erase(std::unique(bandVertices.begin(), bandVertices.end(),
+				[](const BandVertex& a, const BandVertex& b) {
+					return a.index == b.index;
+				}), bandVertices.end());
+			const auto bandNumber = [&bandVertices](const Index vertex) {
+				return static_cast<Index>(std::lower_bound(bandVertices.begin(), bandVertices.end(),
+					static_cast<IndexType>(vertex), [](const BandVertex& bandVertex, IndexType index) {
+						return bandVertex.index < index;
+					}) - bandVertices.begin());
+			};
+			for (auto& crossingFace : crossingFaces) {
+				crossingFace.key = { bandNumber(crossingFace.key.first),
+					bandNumber(crossingFace.key.second) };
+				crossingFace.closingVertex = bandNumber(crossingFace.closingVertex);
+			}
+			std::vector<Vec3D> positions;
+			positions.reserve(bandVertices.size());
+			workspace.vertexOffsets.clear();
+			for (const auto& bandVertex : bandVertices) {
+				positions.push_back(bandVertex.position);
+				workspace.vertexOffsets.push_back(bandVertex.offset);
+			}
+			bandVertices.clear();
+			bandVertices.shrink_to_fit();
+
+			EdgePaths(nullptr, 0, 1, workspace);
+			ChainEdgePaths(workspace);
+			const std::vector<Face> noFaces;
+			const Mesh band(positions, noFaces);
+			std::vector<Path3D> result;
+			ConstructGeometricPaths(band, plane, workspace.chainedPaths, workspace.vertexOffsets, 1, result);
+			return result;
+		}
+
+		static std::vector<std::pair<FloatType, FloatType>> FaceExtents(
+			const ArrayView<Face> faces, const std::vector<FloatType>& projections) {
+			std::vector<std::pair<FloatType, FloatType>> extents;
+			extents.reserve(faces.size());
+			for (const auto& face : faces) {
+				const auto& p0(projections[face[0]]);
+				const auto& p1(projections[face[1]]);
+				const auto& p2(projections[face[2]]);
+				extents.push_back({ std::min({ p0, p1, p2 }), std::max({ p0, p1, p2 }) });
+			}
+			return extents;
+		}
+
+		// fills result with one path per edge path, reusing the paths already in it
+		template <typename PlaneType>
+		static void ConstructGeometricPaths(const Mesh& mesh, const PlaneType& plane,
+			const EdgePathList& edgePaths,
+			const std::vector<FloatType>& vertexOffsets, const size_t threadCount,
+			std::vector<Path3D>& result, const FloatType tolerance = 0) {
+			result.resize(PathCount(edgePaths));
+			ParallelFor(threadCount, result.size(), 1, [&](size_t, size_t begin, size_t end) {
+				for (size_t iPath(begin); iPath < end; ++iPath) {
+					auto& path(result[iPath]);
+					path.points.clear();
+					const auto addPoint = [&path](const Vec3D& point) { path.points.push_back(point); };
+					if (tolerance > 0) {
+						PathSimplifier<decltype(addPoint)> simplifier(tolerance, addPoint);
+						path.isClosed = PathPoints(mesh, plane, edgePaths, iPath, vertexOffsets,
+							[&simplifier](const Vec3D& point) { simplifier.Add(point); });
+						simplifier.Finish(path.isClosed);
+					}
+					else {
+						path.isClosed = PathPoints(mesh, plane, edgePaths, iPath, vertexOffsets, addPoint);
+					}
+				}
+			});
+		}
+
+		// passes on the points of a path as they are added, leaving out those within
+		// tolerance of the segment from the last point passed on to a later one. the points
+		// since the last one passed on are held back, up to windowSize of them, which bounds
+		// the work per point and keeps them off the heap
+		template <typename AddPoint>
+		class PathSimplifier {
+		public:
+			PathSimplifier(const FloatType tolerance, const AddPoint& addPoint) :
+				squaredTolerance(tolerance * tolerance), addPoint(addPoint) {}
+
+			void Add(const Vec3D& point) {
+				if (keptCount == 0) {
+					Keep(point);
+					first = point;
+				}
+				else if (heldCount < windowSize && AreHeldNear(point)) {
+					held[heldCount++] = point;
+				}
+				else {
+					Keep(held[heldCount - 1]);
+					held[0] = point;
+					heldCount = 1;
+				}
+			}
+
+			// the last point of an open path is kept. a closed path runs on back to its first
+			// point, and keeps at least three points if it had them
+			void Finish(const bool isClosed) {
+				if (heldCount == 0) {
+					return;
+				}
+				if (isClosed && keptCount >= 3 && AreHeldNear(first)) {
+					return;
+				}
+				if (isClosed && keptCount == 1 && heldCount >= 2) {
+					Keep(held[heldCount / 2]);
+				}
+				Keep(held[heldCount - 1]);
+			}
+
+		private:
+			static const int windowSize = 64;
+			const FloatType squaredTolerance;
+			const AddPoint& addPoint;
+			std::array<Vec3D, windowSize> held;
+			int heldCount = 0;
+			size_t keptCount = 0;
+			Vec3D first, last;
+
+			void Keep(const Vec3D& point) {
+				addPoint(point);
+				last = point;
+				++keptCount;
+			}
+
+			// whether the held points are all within tolerance of the segment from the last
+			// point kept to end
+			bool AreHeldNear(const Vec3D& end) const {
+				Vec3D side;
+				FloatType squaredLength(0);
+				for (int i(0); i < 3; ++i) {
+					side[i] = end[i] - last[i];
+					squaredLength += side[i] * side[i];
+				}
+				for (int iHeld(0); iHeld < heldCount; ++iHeld) {
+					FloatType along(0);
+					for (int i(0); i < 3; ++i) {
+						along += (held[iHeld][i] - last[i]) * side[i];
+					}
+					const FloatType factor(squaredLength > 0 ?
+						std::min<FloatType>(1, std::max<FloatType>(0, along / squaredLength)) : 0);
+					FloatType squaredDistance(0);
+					for (int i(0); i < 3; ++i) {
+						const FloatType difference(held[iHeld][i] - last[i] - side[i] * factor);
+						squaredDistance += difference * difference;
+					}
+					if (squaredDistance > squaredTolerance) {
+						return false;
+					}
+				}
+				return true;
+			}
+		};
+
+		// each path has a point for every edge but the last one if it is closed, so the
+		// starts are known before the points are worked out
+		template <typename PlaneType>
+		static void ConstructFlatPaths(const Mesh& mesh, const PlaneType& plane,
+			const EdgePathList& edgePaths,
+			const std::vector<FloatType>& vertexOffsets, const size_t threadCount,
+			FlatPaths& result) {
+			const size_t pathCount(FlatStarts(edgePaths, result.starts, result.isClosed));
+			result.points.resize(result.starts.back());
+			ParallelFor(threadCount, pathCount, 1, [&](size_t, size_t begin, size_t end) {
+				for (size_t iPath(begin); iPath < end; ++iPath) {
+					auto point(result.points.begin() + result.starts[iPath]);
+					PathPoints(mesh, plane, edgePaths, iPath, vertexOffsets,
+						[&point](const Vec3D& newPoint) { *point++ = newPoint; });
+				}
+			});
+		}
+
+		static void ConstructSymbolicPaths(const EdgePathList& edgePaths,
+			const std::vector<FloatType>& vertexOffsets, const size_t threadCount,
+			SymbolicPaths& result) {
+			const size_t pathCount(FlatStarts(edgePaths, result.starts, result.isClosed));
+			result.points.resize(result.starts.back());
+			ParallelFor(threadCount, pathCount, 1, [&](size_t, size_t begin, size_t end) {
+				for (size_t iPath(begin); iPath < end; ++iPath) {
+					auto point(result.points.begin() + result.starts[iPath]);
+					PathEdgePoints(edgePaths, iPath, vertexOffsets,
+						[&point](const EdgePoint& newPoint) { *point++ = newPoint; });
+				}
+			});
+		}
+
+		// the integrals over the region inside a path of 1, u, v, u squared, v squared and
+		// u times v, from Green's theorem over each of its sides, and its length
+		struct AreaIntegrals {
+			std::array<FloatType, 6> moments;
+			FloatType perimeter;
+			bool isClosed;
+
+			void Add(const AreaIntegrals& other) {
+				for (size_t i(0); i < moments.size(); ++i) {
+					moments[i] += other.moments[i];
+				}
+				perimeter += other.perimeter;
+			}
+		};
+
+		static void ConstructProperties(const Mesh& mesh, const Plane& plane, Workspace& workspace,
+			const size_t threadCount, std::vector<AreaProperties>& loops, AreaProperties& total) {
+			const PlaneFrame frame(plane);
+			const auto& edgePaths(workspace.chainedPaths);
+			auto& integrals(workspace.areaIntegrals);
+			integrals.resize(PathCount(edgePaths));
+			ParallelFor(threadCount, integrals.size(), 1, [&](size_t, size_t begin, size_t end) {
+				for (size_t iPath(begin); iPath < end; ++iPath) {
+					auto& pathIntegrals(integrals[iPath]);
+					pathIntegrals = AreaIntegrals();
+					bool isFirst(true);
+					Vec3D first, previous;
+					const auto addSide = [&](const Vec3D& a, const Vec3D& b) {
+						AddSide(frame.Coordinates(a), frame.Coordinates(b), pathIntegrals.moments);
+						FloatType squaredLength(0);
+						for (int i(0); i < 3; ++i) {
+							squaredLength += (b[i] - a[i]) * (b[i] - a[i]);
+						}
+						pathIntegrals.perimeter += std::sqrt(squaredLength);
+					};
+					pathIntegrals.isClosed = PathPoints(mesh, plane, edgePaths, iPath,
+						workspace.vertexOffsets, [&](const Vec3D& point) {
+							if (isFirst) {
+								first = point;
+								isFirst = false;
+							}
+							else {
+								addSide(previous, point);
+							}
+							previous = point;
+						});
+					if (pathIntegrals.isClosed && !isFirst) {
+						addSide(previous, first);
+					}
+				}
+			});
+			loops.clear();
+			AreaIntegrals totalIntegrals = AreaIntegrals();
+			for (const auto& pathIntegrals : integrals) {
+				if (pathIntegrals.isClosed) {
+					loops.push_back(Properties(frame, pathIntegrals));
+					totalIntegrals.Add(pathIntegrals);
+				}
+			}
+			total = Properties(frame, totalIntegrals);
+		}
+
+		// the terms of the polygon area integrals for the side from a to b. the paths run
+		// clockwise around the inside of the mesh looking down the normal, so the terms
+		// are negated to make its area positive
+		static void AddSide(const Vec2D& a, const Vec2D& b,
+			std::array<FloatType, 6>& moments) {
+			const FloatType cross(b[0] * a[1] - a[0] * b[1]);
+			moments[0] += cross / 2;
+			moments[1] += (a[0] + b[0]) * cross / 6;
+			moments[2] += (a[1] + b[1]) * cross / 6;
+			moments[3] += (a[0] * a[0] + a[0] * b[0] + b[0] * b[0]) * cross / 12;
+			moments[4] += (a[1] * a[1] + a[1] * b[1] + b[1] * b[1]) * cross / 12;
+			moments[5] += (a[0] * b[1] + 2 * a[0] * a[1] + 2 * b[0] * b[1] + b[0] * a[1]) * cross / 24;
+		}
+
+		// moves the second moments to the centroid
+		static AreaProperties Properties(const PlaneFrame& frame, const AreaIntegrals& integrals) {
+			const auto& moments(integrals.moments);
+			AreaProperties properties;
+			properties.area = moments[0];
+			properties.perimeter = integrals.perimeter;
+			properties.centroid = frame.origin;
+			if (moments[0] == 0) {
+				return properties;
+			}
+			const FloatType u(moments[1] / moments[0]), v(moments[2] / moments[0]);
+			for (int i(0); i < 3; ++i) {
+				properties.centroid[i] += frame.u[i] * u + frame.v[i] * v;
+			}
+			properties.secondMoments = { moments[3] - moments[0] * u * u,
+				moments[4] - moments[0] * v * v, moments[5] - moments[0] * u * v };
+			return properties;
+		}
+
+		static void ConstructPolygons(const Mesh& mesh, const Plane& plane, Workspace& workspace,
+			const size_t threadCount, std::vector<Polygon2D>& result) {
+			const PlaneFrame frame(plane);
+			const auto& edgePaths(workspace.chainedPaths);
+			auto& closedPaths(workspace.closedPaths);
+			closedPaths.clear();
+			for (size_t iPath(0); iPath < PathCount(edgePaths); ++iPath) {
+				if (edgePaths.edges[edgePaths.starts[iPath]] == edgePaths.edges[edgePaths.starts[iPath + 1] - 1]) {
+					closedPaths.push_back(iPath);
+				}
+			}
+			result.resize(closedPaths.size());
+			ParallelFor(threadCount, result.size(), 1, [&](size_t, size_t begin, size_t end) {
+				for (size_t i(begin); i < end; ++i) {
+					auto& polygon(result[i]);
+					polygon.points.clear();
+					PathPoints(mesh, plane, edgePaths, closedPaths[i], workspace.vertexOffsets,
+						[&](const Vec3D& point) { polygon.points.push_back(frame.Coordinates(point)); });
+				}
+			});
+			NestPolygons(workspace, result);
+		}
+
+		struct PolygonBounds {
+			Vec2D min, max;
+			// the area from the shoelace formula, which is positive anticlockwise
+			FloatType area;
+		};
+
+		// sets the parent, children and depth of each polygon and turns it the right way
+		// round. the loops around a polygon are those crossed an odd number of times by a
+		// ray from a point on it, which are found by sweeping across u: each polygon is
+		// tested at the midpoint of its first side against the polygons whose bounds take
+		// in that point, smallest first, and the first to contain it is its parent. the
+		// polygons don't cross each other, so only larger ones can contain it
+		static void NestPolygons(Workspace& workspace, std::vector<Polygon2D>& polygons) {
+			auto& bounds(workspace.polygonBounds);
+			bounds.resize(polygons.size());
+			auto& queryPoints(workspace.queryPoints);
+			queryPoints.resize(polygons.size());
+			for (size_t i(0); i < polygons.size(); ++i) {
+				const auto& points(polygons[i].points);
+				auto& polygonBounds(bounds[i]);
+				polygonBounds.min.fill(std::numeric_limits<FloatType>::max());
+				polygonBounds.max.fill(std::numeric_limits<FloatType>::lowest());
+				polygonBounds.area = 0;
+				for (size_t iPoint(0); iPoint < points.size(); ++iPoint) {
+					const auto& a(points[iPoint]);
+					const auto& b(points[iPoint + 1 < points.size() ? iPoint + 1 : 0]);
+					for (int j(0); j < 2; ++j) {
+						polygonBounds.min[j] = std::min(polygonBounds.min[j], a[j]);
+						polygonBounds.max[j] = std::max(polygonBounds.max[j], a[j]);
+					}
+					polygonBounds.area += (a[0] * b[1] - b[0] * a[1]) / 2;
+				}
+				if (!points.empty()) {
+					const auto& b(points[points.size() > 1 ? 1 : 0]);
+					queryPoints[i] = { (points[0][0] + b[0]) / 2, (points[0][1] + b[1]) / 2 };
+				}
+				polygons[i].parent = -1;
+				polygons[i].children.clear();
+			}
+
+			// sorted by their lowest u, and later by decreasing area
+			auto& order(workspace.polygonOrder);
+			auto& byQuery(workspace.polygonQueries);
+			order.resize(polygons.size());
+			for (size_t i(0); i < order.size(); ++i) {
+				order[i] = static_cast<int>(i);
+			}
+			byQuery = order;
+			std::sort(order.begin(), order.end(), [&bounds](int a, int b) {
+				return bounds[a].min[0] < bounds[b].min[0];
+			});
+			std::sort(byQuery.begin(), byQuery.end(), [&queryPoints](int a, int b) {
+				return queryPoints[a][0] < queryPoints[b][0];
+			});
+			auto& active(workspace.activePolygons);
+			auto& candidates(workspace.candidatePolygons);
+			active.clear();
+			size_t added(0);
+			for (const int iPolygon : byQuery) {
+				if (polygons[iPolygon].points.empty()) {
+					continue;
+				}
+				const auto& point(queryPoints[iPolygon]);
+				while (added < order.size() && bounds[order[added]].min[0] <= point[0]) {
+					active.push_back(order[added++]);
+				}
+				active.erase(std::remove_if(active.begin(), active.end(), [&](int i) {
+					return bounds[i].max[0] < point[0];
+				}), active.end());
+				const FloatType area(std::abs(bounds[iPolygon].area));
+				candidates.clear();
+				for (const int i : active) {
+					if (std::abs(bounds[i].area) > area && bounds[i].min[1] <= point[1] &&
+						point[1] <= bounds[i].max[1]) {
+						candidates.push_back(i);
+					}
+				}
+				std::sort(candidates.begin(), candidates.end(), [&bounds](int a, int b) {
+					return std::abs(bounds[a].area) < std::abs(bounds[b].area);
+				});
+				for (const int i : candidates) {
+					if (Contains(polygons[i].points, point)) {
+						polygons[iPolygon].parent = i;
+						break;
+					}
+				}
+			}
+
+			// parents are larger, so they come first by area
+			std::sort(order.begin(), order.end(), [&bounds](int a, int b) {
+				return std::abs(bounds[a].area) > std::abs(bounds[b].area) ||
+					(std::abs(bounds[a].area) == std::abs(bounds[b].area) && a < b);
+			});
+			for (const int i : order) {
+				auto& polygon(polygons[i]);
+				polygon.depth = polygon.parent < 0 ? 0 : polygons[polygon.parent].depth + 1;
+				if (bounds[i].area != 0 && (bounds[i].area > 0) != (polygon.depth % 2 == 0)) {
+					std::reverse(polygon.points.begin(), polygon.points.end());
+				}
+			}
+			for (size_t i(0); i < polygons.size(); ++i) {
+				if (polygons[i].parent >= 0) {
+					polygons[polygons[i].parent].children.push_back(static_cast<int>(i));
+				}
+			}
+		}
+
+		// whether a point is inside a polygon, by the number of its sides crossed by a ray
+		// from the point along v
+		static bool Contains(const std::vector<Vec2D>& points, const Vec2D& point) {
+			bool isInside(false);
+			for (size_t i(0), j(points.size() - 1); i < points.size(); j = i++) {
+				const auto& a(points[i]);
+				const auto& b(points[j]);
+				if ((a[0] > point[0]) != (b[0] > point[0]) &&
+					a[1] + (point[0] - a[0]) * (b[1] - a[1]) / (b[0] - a[0]) > point[1]) {
+					isInside = !isInside;
+				}
+			}
+			return isInside;
+		}
+
+		static void _Split(const Mesh& mesh, const Plane& plane, const bool isCapped,
+			const size_t threadCount, Workspace& workspace, IndexedMesh& above, IndexedMesh& below) {
+			auto& statistics(workspace.statistics);
+			StartStatistics(workspace);
+			{
+				StepTimer timer(statistics.vertexOffsetSeconds);
+				VertexOffsets(mesh, plane, workspace.vertexOffsets, workspace.vertexSigns, threadCount);
+			}
+			{
+				StepTimer timer(statistics.crossingFaceSeconds);
+				CrossingFaces(mesh.faces, threadCount, workspace);
+			}
+			Count(statistics.crossingFaces, workspace.crossingFaces.size());
+			{
+				StepTimer timer(statistics.pathSeconds);
+				SplitFaces(mesh, plane, workspace, above, below);
+			}
+			if (isCapped) {
+				{
+					StepTimer timer(statistics.edgePathSeconds);
+					EdgePaths(mesh.topology.get(), mesh.faces.size(), threadCount, workspace);
+				}
+				Count(statistics.edgePaths, PathCount(workspace.edgePaths));
+				{
+					StepTimer timer(statistics.chainSeconds);
+					ChainEdgePaths(workspace);
+				}
+				Count(statistics.chainProbes, workspace.endpoints.probes);
+				Count(statistics.chainedPaths, PathCount(workspace.chainedPaths));
+				StepTimer timer(statistics.pathSeconds);
+				CapParts(plane, workspace, above, below);
+			}
+			FinishStatistics(workspace);
+		}
+
+		// the vertices of each part are the mesh vertices on its side, in mesh order,
+		// followed by the cut vertices in the order of their keys. the faces are cut using
+		// the crossing faces' edges, so each edge crossing the plane gives one cut vertex
+		static void SplitFaces(const Mesh& mesh, const Plane& plane, Workspace& workspace,
+			IndexedMesh& above, IndexedMesh& below) {
+			const auto& offsets(workspace.vertexOffsets);
+			auto& cutKeys(workspace.cutKeys);
+			cutKeys.clear();
+			for (const auto& crossingFace : workspace.crossingFaces) {
+				cutKeys.push_back(CutKey(offsets, crossingFace.key.first, crossingFace.key.second));
+				cutKeys.push_back(CutKey(offsets, crossingFace.key.second, crossingFace.closingVertex));
+			}
+			std::sort(cutKeys.begin(), cutKeys.end());
+			cutKeys.erase(std::unique(cutKeys.begin(), cutKeys.end()), cutKeys.end());
+
+			const std::array<IndexedMesh*, 2> parts{ { &above, &below } };
+			auto& partNumbers(workspace.partNumbers);
+			auto& cutNumbers(workspace.cutNumbers);
+			for (int iPart(0); iPart < 2; ++iPart) {
+				auto& part(*parts[iPart]);
+				part.vertices.clear();
+				part.faces.clear();
+				partNumbers[iPart].resize(mesh.vertices.size());
+				for (size_t iVertex(0); iVertex < mesh.vertices.size(); ++iVertex) {
+					const bool isOnSide((offsets[iVertex] > 0) == (iPart == 0));
+					partNumbers[iPart][iVertex] = isOnSide ? static_cast<Index>(part.vertices.size()) : -1;
+					if (isOnSide) {
+						part.vertices.push_back(mesh.vertices[iVertex]);
+					}
+				}
+				cutNumbers[iPart].resize(cutKeys.size());
+			}
+			auto& cutPoints(workspace.cutPoints);
+			cutPoints.resize(cutKeys.size());
+			for (size_t i(0); i < cutKeys.size(); ++i) {
+				const Edge& key(cutKeys[i]);
+				if (key.first == key.second) {
+					// a vertex on the plane, which the part above already has
+					cutPoints[i] = mesh.vertices[key.first];
+					cutNumbers[0][i] = partNumbers[0][key.first];
+				}
+				else {
+					const FloatType offset1(offsets[key.first]), offset2(offsets[key.second]);
+					cutPoints[i] = CutPoint(mesh.vertices[key.first], mesh.vertices[key.second],
+						offset1 / (offset1 - offset2), plane);
+					cutNumbers[0][i] = static_cast<Index>(above.vertices.size());
+					above.vertices.push_back(cutPoints[i]);
+				}
+				cutNumbers[1][i] = static_cast<Index>(below.vertices.size());
+				below.vertices.push_back(cutPoints[i]);
+			}
+
+			const auto cutNumber = [&](const int iPart, const Index a, const Index b) {
+				return cutNumbers[iPart][CutNumber(cutKeys, CutKey(offsets, a, b))];
+			};
+			for (const auto& face : mesh.faces) {
+				const std::array<bool, 3> isAbove{ { offsets[face[0]] > 0, offsets[face[1]] > 0,
+					offsets[face[2]] > 0 } };
+				if (isAbove[0] == isAbove[1] && isAbove[1] == isAbove[2]) {
+					const int iPart(isAbove[0] ? 0 : 1);
+					const auto& numbers(partNumbers[iPart]);
+					AddPartFace(*parts[iPart], numbers[face[0]], numbers[face[1]], numbers[face[2]]);
+					continue;
+				}
+				// the corner on its own side gets a triangle, and the other two a quad
+				const int odd(isAbove[0] == isAbove[1] ? 2 : isAbove[0] == isAbove[2] ? 1 : 0);
+				const Index a(face[odd]), b(face[(odd + 1) % 3]), c(face[(odd + 2) % 3]);
+				const int oddPart(isAbove[odd] ? 0 : 1), otherPart(1 - oddPart);
+				AddPartFace(*parts[oddPart], partNumbers[oddPart][a],
+					cutNumber(oddPart, a, b), cutNumber(oddPart, c, a));
+				const Index ab(cutNumber(otherPart, a, b)), ca(cutNumber(otherPart, c, a));
+				const auto& numbers(partNumbers[otherPart]);
+				AddPartFace(*parts[otherPart], ab, numbers[b], numbers[c]);
+				AddPartFace(*parts[otherPart], ab, numbers[c], ca);
+			}
+		}
+
+		// the cut vertex of an edge crossing the plane is keyed by the edge, or by (v, v)
+		// when vertex v is on the plane, as it is then the cut vertex itself
+		static Edge CutKey(const std::vector<FloatType>& offsets, const Index a, const Index b) {
+			if (offsets[a] == OnPlaneOffset()) {
+				return { a, a };
+			}
+			if (offsets[b] == OnPlaneOffset()) {
+				return { b, b };
+			}
+			return { std::min(a, b), std::max(a, b) };
+		}
+
+		static size_t CutNumber(const std::vector<Edge>& cutKeys, const Edge& key) {
+			return static_cast<size_t>(std::lower_bound(cutKeys.begin(), cutKeys.end(), key) -
+				cutKeys.begin());
+		}
+
+		// faces with a repeated corner, from a vertex on the plane, are left out
+		static void AddPartFace(IndexedMesh& part, const Index a, const Index b, const Index c) {
+			if (a != b && b != c && c != a) {
+				part.faces.push_back({ { static_cast<IndexType>(a), static_cast<IndexType>(b),
+					static_cast<IndexType>(c) } });
+			}
+		}
+
+		// triangulates each outline of the section along with the holes directly inside it.
+		// the triangles run anticlockwise in the PlaneFrame, so they face along the normal,
+		// out of the part below, and are turned over for the part above
+		static void CapParts(const Plane& plane, Workspace& workspace, IndexedMesh& above,
+			IndexedMesh& below) {
+			const PlaneFrame frame(plane);
+			const auto& edgePaths(workspace.chainedPaths);
+			const auto& cutKeys(workspace.cutKeys);
+			auto& coordinates(workspace.cutCoordinates);
+			coordinates.resize(cutKeys.size());
+			for (size_t i(0); i < cutKeys.size(); ++i) {
+				coordinates[i] = frame.Coordinates(workspace.cutPoints[i]);
+			}
+			auto& loops(workspace.capLoops);
+			auto& polygons(workspace.capPolygons);
+			loops.resize(std::max(loops.size(), PathCount(edgePaths)));
+			polygons.resize(PathCount(edgePaths));
+			size_t loopCount(0);
+			for (size_t iPath(0); iPath < PathCount(edgePaths); ++iPath) {
+				auto& loop(loops[loopCount]);
+				loop.clear();
+				const bool isClosed(PathEdgePoints(edgePaths, iPath, workspace.vertexOffsets,
+					[&](const EdgePoint& point) {
+						const Index first(static_cast<Index>(point.first)), second(static_cast<Index>(point.second));
+						const Edge key(std::min(first, second), std::max(first, second));
+						const size_t cut(CutNumber(cutKeys, key));
+						// paths through a vertex on the plane pass it on several edges
+						if (cut < cutKeys.size() && cutKeys[cut] == key &&
+							(loop.empty() || loop.back() != static_cast<Index>(cut))) {
+							loop.push_back(static_cast<Index>(cut));
+						}
+					}));
+				while (loop.size() > 1 && loop.back() == loop.front()) {
+					loop.pop_back();
+				}
+				if (isClosed && loop.size() >= 3) {
+					auto& points(polygons[loopCount].points);
+					points.clear();
+					for (const Index cut : loop) {
+						points.push_back(coordinates[cut]);
+					}
+					++loopCount;
+				}
+			}
+			polygons.resize(loopCount);
+			NestPolygons(workspace, polygons);
+
+			// the same turning round as NestPolygons, on the loops of cut numbers
+			for (size_t i(0); i < loopCount; ++i) {
+				const FloatType area(workspace.polygonBounds[i].area);
+				if (area != 0 && (area > 0) != (polygons[i].depth % 2 == 0)) {
+					std::reverse(loops[i].begin(), loops[i].end());
+				}
+			}
+			auto& ring(workspace.capRing);
+			for (size_t i(0); i < loopCount; ++i) {
+				if (polygons[i].depth % 2 != 0) {
+					continue;
+				}
+				ring = loops[i];
+				// holes further along u first, so that each bridge only crosses the ones
+				// already joined to the ring. the polygons are the workspace's own, so their
+				// children can be sorted where they are
+				auto& children(polygons[i].children);
+				std::sort(children.begin(), children.end(), [&workspace](int a, int b) {
+					return workspace.polygonBounds[a].max[0] > workspace.polygonBounds[b].max[0];
+				});
+				for (const int iHole : children) {
+					BridgeHole(coordinates, loops[iHole], workspace.capBridge, ring);
+				}
+				ClipEars(coordinates, ring, workspace.capLinks, [&](Index a, Index b, Index c) {
+					AddPartFace(below, workspace.cutNumbers[1][a], workspace.cutNumbers[1][b],
+						workspace.cutNumbers[1][c]);
+					AddPartFace(above, workspace.cutNumbers[0][a], workspace.cutNumbers[0][c],
+						workspace.cutNumbers[0][b]);
+				});
+			}
+		}
+
+		// joins a hole into the ring around it, by a pair of sides to its vertex furthest
+		// along u from a ring vertex it can see. that is the nearer end of the side first
+		// hit by a ray along u, unless ring vertices inside the triangle between the ray
+		// and that end hide it, in which case it is the one of these at the smallest angle
+		// to the ray
+		static void BridgeHole(const std::vector<Vec2D>& coordinates, const std::vector<Index>& hole,
+			std::vector<Index>& bridge, std::vector<Index>& ring) {
+			size_t iStart(0);
+			for (size_t i(1); i < hole.size(); ++i) {
+				if (coordinates[hole[i]][0] > coordinates[hole[iStart]][0]) {
+					iStart = i;
+				}
+			}
+			const Vec2D& start(coordinates[hole[iStart]]);
+			FloatType hit(std::numeric_limits<FloatType>::max());
+			size_t iEnd(ring.size());
+			for (size_t i(0); i < ring.size(); ++i) {
+				const Vec2D& a(coordinates[ring[i]]);
+				const Vec2D& b(coordinates[ring[i + 1 < ring.size() ? i + 1 : 0]]);
+				if ((a[1] > start[1]) != (b[1] > start[1])) {
+					const FloatType u(a[0] + (start[1] - a[1]) * (b[0] - a[0]) / (b[1] - a[1]));
+					if (u >= start[0] && u < hit) {
+						hit = u;
+						iEnd = a[0] > b[0] ? i : (i + 1 < ring.size() ? i + 1 : 0);
+					}
+				}
+			}
+			if (iEnd == ring.size()) {
+				return;
+			}
+			const Vec2D crossing{ { hit, start[1] } };
+			const Vec2D end(coordinates[ring[iEnd]]);
+			const auto angle = [&start](const Vec2D& point) {
+				const FloatType across(std::abs(point[1] - start[1])), along(point[0] - start[0]);
+				return along > 0 ? across / along : across == 0 ? 0 : std::numeric_limits<FloatType>::max();
+			};
+			FloatType bestAngle(std::numeric_limits<FloatType>::max());
+			size_t iBest(ring.size());
+			for (size_t i(0); i < ring.size(); ++i) {
+				const Vec2D& point(coordinates[ring[i]]);
+				if ((ring[i] == ring[iEnd] || IsInTriangle(start, crossing, end, point)) &&
+					IsLocallyInside(coordinates, ring, i, start)) {
+					const FloatType pointAngle(angle(point));
+					if (pointAngle < bestAngle || (pointAngle == bestAngle &&
+						point[0] < coordinates[ring[iBest]][0])) {
+						bestAngle = pointAngle;
+						iBest = i;
+					}
+				}
+			}
+			if (iBest == ring.size()) {
+				iBest = iEnd;
+			}
+			// the ring goes out to the hole, round it and back again
+			bridge.clear();
+			for (size_t i(0); i <= hole.size(); ++i) {
+				bridge.push_back(hole[(iStart + i) % hole.size()]);
+			}
+			bridge.push_back(ring[iBest]);
+			ring.insert(ring.begin() + iBest + 1, bridge.begin(), bridge.end());
+		}
+
+		// whether the direction from ring vertex i to point is into the ring, which runs
+		// anticlockwise
+		static bool IsLocallyInside(const std::vector<Vec2D>& coordinates,
+			const std::vector<Index>& ring, const size_t i, const Vec2D& point) {
+			const Vec2D& vertex(coordinates[ring[i]]);
+			const Vec2D& previous(coordinates[ring[i > 0 ? i - 1 : ring.size() - 1]]);
+			const Vec2D& next(coordinates[ring[i + 1 < ring.size() ? i + 1 : 0]]);
+			if (Cross(vertex, next, previous) > 0) {
+				return Cross(vertex, next, point) > 0 && Cross(vertex, point, previous) > 0;
+			}
+			return !(Cross(vertex, previous, point) >= 0 && Cross(vertex, point, next) >= 0);
+		}
+
+		// twice the area of the triangle a, b, c, positive when it runs anticlockwise
+		static FloatType Cross(const Vec2D& a, const Vec2D& b, const Vec2D& c) {
+			return (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+		}
+
+		// including the sides
+		static bool IsInTriangle(const Vec2D& a, const Vec2D& b, const Vec2D& c, const Vec2D& point) {
+			const FloatType ab(Cross(a, b, point)), bc(Cross(b, c, point)), ca(Cross(c, a, point));
+			return (ab >= 0 && bc >= 0 && ca >= 0) || (ab <= 0 && bc <= 0 && ca <= 0);
+		}
+
+		// cuts off corners of an anticlockwise ring, calling addTriangle for each, while
+		// they are convex and no other ring vertex is inside them. if a whole pass round
+		// the ring finds none, which rounding can cause in nearly straight runs, the
+		// current corner is cut off anyway so that the cap stays closed
+		template <typename AddTriangle>
+		static void ClipEars(const std::vector<Vec2D>& coordinates, const std::vector<Index>& ring,
+			std::vector<std::pair<Index, Index>>& links, const AddTriangle& addTriangle) {
+			const Index count(static_cast<Index>(ring.size()));
+			if (count < 3) {
+				return;
+			}
+			links.resize(ring.size());
+			for (Index i(0); i < count; ++i) {
+				links[i] = { i > 0 ? i - 1 : count - 1, i + 1 < count ? i + 1 : 0 };
+			}
+			const auto point = [&](const Index i) -> const Vec2D& {
+				return coordinates[ring[i]];
+			};
+			const auto isEar = [&](const Index previous, const Index i, const Index next) {
+				if (Cross(point(previous), point(i), point(next)) <= 0) {
+					return false;
+				}
+				for (Index j(links[next].second); j != previous; j = links[j].second) {
+					if (ring[j] != ring[previous] && ring[j] != ring[i] && ring[j] != ring[next] &&
+						IsInTriangle(point(previous), point(i), point(next), point(j))) {
+						return false;
+					}
+				}
+				return true;
+			};
+			Index i(0), misses(0);
+			for (Index left(count); left > 3;) {
+				const Index previous(links[i].first), next(links[i].second);
+				if (misses < left && !isEar(previous, i, next)) {
+					++misses;
+					i = next;
+					continue;
+				}
+				addTriangle(ring[previous], ring[i], ring[next]);
+				links[previous].second = next;
+				links[next].first = previous;
+				--left;
+				misses = 0;
+				i = next;
+			}
+			addTriangle(ring[links[i].first], ring[i], ring[links[i].second]);
+		}
+
+		// fills in the starts and isClosed of a flat layout, and returns the path count
+		static size_t FlatStarts(const EdgePathList& edgePaths, std::vector<size_t>& starts,
+			std::vector<bool>& isClosed) {
+			const size_t pathCount(PathCount(edgePaths));
+			starts.assign(1, 0);
+			isClosed.resize(pathCount);
+			for (size_t iPath(0); iPath < pathCount; ++iPath) {
+				const auto& first(edgePaths.edges[edgePaths.starts[iPath]]);
+				const auto& last(edgePaths.edges[edgePaths.starts[iPath + 1] - 1]);
+				isClosed[iPath] = first == last;
+				starts.push_back(starts.back() + edgePaths.starts[iPath + 1] -
+					edgePaths.starts[iPath] - (first == last));
+			}
+			return pathCount;
+		}
+
+		template <typename PlaneType, typename Sink>
+		static void StreamPaths(const Mesh& mesh, const PlaneType& plane, Workspace& workspace,
+			const Sink& sink, const FloatType tolerance) {
+			const auto& edgePaths(workspace.chainedPaths);
+			auto& points(workspace.pathPoints);
+			const auto addPoint = [&points](const Vec3D& point) { points.push_back(point); };
+			for (size_t iPath(0); iPath < PathCount(edgePaths); ++iPath) {
+				points.clear();
+				bool isClosed;
+				if (tolerance > 0) {
+					PathSimplifier<decltype(addPoint)> simplifier(tolerance, addPoint);
+					isClosed = PathPoints(mesh, plane, edgePaths, iPath, workspace.vertexOffsets,
+						[&simplifier](const Vec3D& point) { simplifier.Add(point); });
+					simplifier.Finish(isClosed);
+				}
+				else {
+					isClosed = PathPoints(mesh, plane, edgePaths, iPath, workspace.vertexOffsets, addPoint);
+				}
+				sink(static_cast<const Vec3D*>(points.data()), points.size(), isClosed);
+			}
+		}
+
+		// calls addPoint for each point of a path, and returns whether it is closed
+		template <typename PlaneType, typename AddPoint>
+		static bool PathPoints(const Mesh& mesh, const PlaneType& plane,
+			const EdgePathList& edgePaths, const size_t iPath,
+			const std::vector<FloatType>& vertexOffsets, const AddPoint& addPoint) {
+			return PathEdgePoints(edgePaths, iPath, vertexOffsets,
+				[&](const EdgePoint& point) {
+					const auto& edgeStart(mesh.vertices.at(point.first));
+					addPoint(point.first == point.second ? edgeStart :
+						CutPoint(edgeStart, mesh.vertices.at(point.second), point.factor, plane));
+				});
+		}
+
+		// the same, but with the points as edge points
+		template <typename AddPoint>
+		static bool PathEdgePoints(const EdgePathList& edgePaths, const size_t iPath,
+			const std::vector<FloatType>& vertexOffsets, const AddPoint& addPoint) {
+			const Edge* begin(edgePaths.edges.data() + edgePaths.starts[iPath]);
+			const Edge* end(edgePaths.edges.data() + edgePaths.starts[iPath + 1]);
+			const bool isClosed = *begin == *(end - 1);
+			bool skipThisPoint = isClosed;
+			for (auto edge(begin); edge != end; ++edge) {
+				const auto first(static_cast<IndexType>(edge->first));
+				const auto second(static_cast<IndexType>(edge->second));
+				if (skipThisPoint) {
+					skipThisPoint = false;
+				}
+				else if (edge->first == edge->second || vertexOffsets[edge->first] == OnPlaneOffset()) {
+					addPoint(EdgePoint{ first, first, 0 });
+				}
+				else if (vertexOffsets[edge->second] == OnPlaneOffset()) {
+					addPoint(EdgePoint{ second, second, 0 });
+				}
+				else {
+					const auto& offset1(vertexOffsets[edge->first]);
+					const auto& offset2(vertexOffsets[edge->second]);
+					addPoint(EdgePoint{ first, second, offset1 / (offset1 - offset2) });
+				}
+			}
+			return isClosed;
+		}
+
+		// the point a fraction 'factor' of the way along an edge crossing the plane
+		static Vec3D CutPoint(const Vec3D& edgeStart, const Vec3D& edgeEnd, const FloatType factor,
+			const Plane&) {
+			Vec3D point;
+			for (int i(0); i < 3; ++i) {
+				point[i] = edgeStart[i] + (edgeEnd[i] - edgeStart[i]) * factor;
+			}
+			return point;
+		}
+
+		// only the two coordinates across the axis are interpolated
+		template <int Axis, int Sign>
+		static Vec3D CutPoint(const Vec3D& edgeStart, const Vec3D& edgeEnd, const FloatType factor,
+			const AxisPlane<Axis, Sign>& plane) {
+			Vec3D point;
+			for (int i(0); i < 3; ++i) {
+				if (i != Axis) {
+					point[i] = edgeStart[i] + (edgeEnd[i] - edgeStart[i]) * factor;
+				}
+			}
+			point[Axis] = plane.position;
+			return point;
+		}
+
+		static const std::vector<FloatType> VertexOffsets(const ArrayView<Vec3D> vertices,
+			const Plane& plane) {
+			std::vector<FloatType> offsets;
+			offsets.reserve(vertices.size());
+			std::transform(vertices.begin(), vertices.end(), std::back_inserter(offsets),
+				[&plane](const auto& vertex) {
+					return PlaneOffset(vertex, plane);
+				});
+			return offsets;
+		}
+
+		// the rounded distance of a point along the normal, for projections onto it
+		static FloatType PlaneOffset(const Vec3D& vertex, const Plane& plane) {
+			FloatType offset(0);
+			for (int i(0); i < 3; ++i) {
+				offset += plane.normal[i] * (vertex[i] - plane.origin[i]);
+			}
+			return offset;
+		}
+
+		// the offset used to classify a vertex, which is never zero and always has the
+		// sign of the exact offset. a vertex exactly on the plane counts as above it, as
+		// if the plane were moved an infinitesimal distance against its normal, so every
+		// face touching the plane is either crossed or not and the contours stay closed.
+		// the rounded offset is only checked exactly when it is within its error bound, or
+		// so small that it could be mistaken for OnPlaneOffset()
+		static FloatType VertexOffset(const Vec3D& vertex, const Plane& plane) {
+			FloatType offset(0), magnitude(0);
+			for (int i(0); i < 3; ++i) {
+				const FloatType term(plane.normal[i] * (vertex[i] - plane.origin[i]));
+				offset += term;
+				magnitude += std::abs(term);
+			}
+			return std::abs(offset) <= std::max(OffsetErrorFactor() * magnitude, OnPlaneOffset()) ?
+				RefinedOffset(vertex, plane, offset) : offset;
+		}
+
+		// the subtraction is rounded but keeps its sign, so only zero is moved above
+		template <int Axis, int Sign>
+		static FloatType VertexOffset(const Vec3D& vertex, const AxisPlane<Axis, Sign>& plane) {
+			return ClassifiedAxisOffset(AxisOffset<Sign>(vertex[Axis], plane.position));
+		}
+
+		// zero becomes OnPlaneOffset(), and other offsets no larger than that are moved just
+		// past it with their sign kept, as RefinedOffset does
+		static FloatType ClassifiedAxisOffset(const FloatType offset) {
+			const FloatType smallest(std::nextafter(OnPlaneOffset(),
+				std::numeric_limits<FloatType>::max()));
+			return offset == 0 ? OnPlaneOffset() :
+				std::abs(offset) < smallest ? std::copysign(smallest, offset) : offset;
+		}
+
+		// the offset given to vertices exactly on the plane, the smallest positive normal
+		// value. RefinedOffset and ClassifiedAxisOffset keep every other vertex off it
+		static FloatType OnPlaneOffset() {
+			return std::numeric_limits<FloatType>::min();
+		}
+
+		// a bound on the rounding error of an offset relative to the sum of the magnitudes
+		// of its terms, as computed. each term is rounded in the difference, the product
+		// and at most two of the sums, so with u = epsilon / 2 the error is at most
+		// 4u / (1 - 4u) of the exact magnitudes, and these are at most (1 - 2u)^-2 times
+		// the computed one. that is 2 epsilon plus terms of order epsilon squared, which
+		// 3 epsilon covers. offsets that underflow are caught by the OnPlaneOffset() test
+		static FloatType OffsetErrorFactor() {
+			return 3 * std::numeric_limits<FloatType>::epsilon();
+		}
+
+		// the rounded offset with the exact sign, and larger than OnPlaneOffset() unless
+		// the vertex is on the plane
+		static FloatType RefinedOffset(const Vec3D& vertex, const Plane& plane,
+			const FloatType offset) {
+			const int sign(ExactOffsetSign(vertex, plane));
+			if (sign == 0) {
+				return OnPlaneOffset();
+			}
+			const FloatType magnitude(std::max(std::abs(offset),
+				std::nextafter(OnPlaneOffset(), std::numeric_limits<FloatType>::max())));
+			return sign > 0 ? magnitude : -magnitude;
+		}
+
+		// the sign of the offset without rounding, or 0 if it is zero. each difference is
+		// split into its rounded value and error, and each product of these with the
+		// normal likewise, and the twelve parts are summed exactly as an expansion of
+		// non-overlapping values in increasing magnitude (Shewchuk's arithmetic), whose
+		// sign is that of its largest part
+		static int ExactOffsetSign(const Vec3D& vertex, const Plane& plane) {
+			std::array<FloatType, 12> expansion;
+			size_t size(0);
+			for (int i(0); i < 3; ++i) {
+				const FloatType difference(vertex[i] - plane.origin[i]);
+				const FloatType differenceError(DifferenceError(vertex[i], plane.origin[i], difference));
+				for (const FloatType part : { difference, differenceError }) {
+					const FloatType product(plane.normal[i] * part);
+					GrowExpansion(expansion, size, product);
+					GrowExpansion(expansion, size, std::fma(plane.normal[i], part, -product));
+				}
+			}
+			while (size > 0) {
+				const FloatType part(expansion[--size]);
+				if (part != 0) {
+					return part > 0 ? 1 : -1;
+				}
+			}
+			return 0;
+		}
+
+		// a - b - difference exactly, where difference is a - b rounded
+		static FloatType DifferenceError(const FloatType a, const FloatType b,
+			const FloatType difference) {
+			const FloatType bVirtual(a - difference);
+			const FloatType aVirtual(difference + bVirtual);
+			return (a - aVirtual) + (bVirtual - b);
+		}
+
+		// a + b - sum exactly, where sum is a + b rounded
+		static FloatType SumError(const FloatType a, const FloatType b, const FloatType sum) {
+			const FloatType bVirtual(sum - a);
+			const FloatType aVirtual(sum - bVirtual);
+			return (a - aVirtual) + (b - bVirtual);
+		}
+
+		static void GrowExpansion(std::array<FloatType, 12>& expansion, size_t& size,
+			const FloatType value) {
+			FloatType sum(value);
+			for (size_t i(0); i < size; ++i) {
+				const FloatType total(sum + expansion[i]);
+				expansion[i] = SumError(sum, expansion[i], total);
+				sum = total;
+			}
+			expansion[size++] = sum;
+		}
+
+		template <int Sign, typename Type>
+		static Type AxisOffset(const Type coordinate, const Type position) {
+			return Sign > 0 ? coordinate - position : position - coordinate;
+		}
+
+		static const Plane& GeneralPlane(const Plane& plane) {
+			return plane;
+		}
+
+		template <int Axis, int Sign>
+		static Plane GeneralPlane(const AxisPlane<Axis, Sign>& plane) {
+			return plane.ToPlane();
+		}
+
+		// the offsets of all of the vertices, with their signs packed into bits so that
+		// the faces can be classified without looking at the offsets again
+		template <typename PlaneType>
+		static void VertexOffsets(const Mesh& mesh, const PlaneType& plane,
+			std::vector<FloatType>& offsets, VertexSigns& signs, const size_t threadCount) {
+			const size_t vertexCount(mesh.vertices.size());
+			offsets.resize(vertexCount);
+			signs.positive.resize((vertexCount + 63) / 64);
+			signs.negative.resize(signs.positive.size());
+			// chunks of whole words, so that no two threads write the same one
+			ParallelFor(threadCount, vertexCount, 64, [&](size_t, size_t begin, size_t end) {
+				VertexOffsets(mesh, plane, begin, end, offsets, signs);
+			});
+		}
+
+		template <typename PlaneType>
+		static void VertexOffsets(const Mesh& mesh, const PlaneType& plane, const size_t begin,
+			const size_t end, std::vector<FloatType>& offsets, VertexSigns& signs) {
+			size_t done(begin);
+			if (mesh.vertexArrays) {
+				const auto& coordinates(mesh.vertexArrays->coordinates);
+				done += ArrayOffsets(coordinates[0].data() + begin, coordinates[1].data() + begin,
+					coordinates[2].data() + begin, end - begin, plane, offsets.data() + begin,
+					signs.positive.data() + begin / 64, signs.negative.data() + begin / 64);
+			}
+			for (size_t iWord(done / 64); iWord * 64 < end; ++iWord) {
+				const size_t wordEnd(std::min(iWord * 64 + 64, end));
+				std::uint64_t positive(0), negative(0);
+				for (size_t iVertex(iWord * 64); iVertex < wordEnd; ++iVertex) {
+					const auto offset(VertexOffset(mesh.vertices[iVertex], plane));
+					offsets[iVertex] = offset;
+					positive |= static_cast<std::uint64_t>(offset > 0) << (iVertex % 64);
+					negative |= static_cast<std::uint64_t>(offset < 0) << (iVertex % 64);
+				}
+				signs.positive[iWord] = positive;
+				signs.negative[iWord] = negative;
+			}
+		}
+
+		// the SIMD kernels fill whole words of 64 vertices, and return how many vertices
+		// they did. there are none for other floating point types
+		template <typename Type>
+		static size_t ArrayOffsets(const Type*, const Type*, const Type*, const size_t,
+			const Plane&, Type*, std::uint64_t*, std::uint64_t*) {
+			return 0;
+		}
+
+		// an axis plane only reads one of the arrays, in plain loops the compiler can
+		// vectorize for any floating point type
+		template <typename Type, int Axis, int Sign>
+		static size_t ArrayOffsets(const Type* x, const Type* y, const Type* z,
+			const size_t count, const AxisPlane<Axis, Sign>& plane, Type* offsets,
+			std::uint64_t* positive, std::uint64_t* negative) {
+			const Type* coordinates(Axis == 0 ? x : Axis == 1 ? y : z);
+			const Type position(plane.position);
+			const size_t wordCount(count / 64);
+			for (size_t iWord(0); iWord < wordCount; ++iWord) {
+				const Type* wordCoordinates(coordinates + iWord * 64);
+				Type* wordOffsets(offsets + iWord * 64);
+				for (int iBit(0); iBit < 64; ++iBit) {
+					wordOffsets[iBit] = ClassifiedAxisOffset(AxisOffset<Sign>(wordCoordinates[iBit],
+						position));
+				}
+				std::uint64_t positiveBits(0), negativeBits(0);
+				for (int iBit(0); iBit < 64; ++iBit) {
+					positiveBits |= static_cast<std::uint64_t>(wordOffsets[iBit] > 0) << iBit;
+					negativeBits |= static_cast<std::uint64_t>(wordOffsets[iBit] < 0) << iBit;
+				}
+				positive[iWord] = positiveBits;
+				negative[iWord] = negativeBits;
+			}
+			return wordCount * 64;
+		}
+
+#if defined(MESH_PLANE_INTERSECT_AVX) || defined(MESH_PLANE_INTERSECT_SSE2)
+		// each lane sums the terms in the same order as VertexOffset, so the offsets match
+		static size_t ArrayOffsets(const double* x, const double* y, const double* z,
+			const size_t count, const Plane& plane, double* offsets,
+			std::uint64_t* positive, std::uint64_t* negative) {
+#ifdef MESH_PLANE_INTERSECT_AVX
+			typedef __m256d Lanes;
+			const int width(4);
+			const auto set = [](const double value) { return _mm256_set1_pd(value); };
+			const auto load = [](const double* values) { return _mm256_loadu_pd(values); };
+			const auto store = [](double* values, const Lanes lanes) { _mm256_storeu_pd(values, lanes); };
+			const auto add = [](const Lanes a, const Lanes b) { return _mm256_add_pd(a, b); };
+			const auto subtract = [](const Lanes a, const Lanes b) { return _mm256_sub_pd(a, b); };
+			const auto multiply = [](const Lanes a, const Lanes b) { return _mm256_mul_pd(a, b); };
+			const auto absolute = [](const Lanes a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); };
+			const auto above = [](const Lanes a, const Lanes b) {
+				return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_GT_OQ));
+			};
+#else
+			typedef __m128d Lanes;
+			const int width(2);
+			const auto set = [](const double value) { return _mm_set1_pd(value); };
+			const auto load = [](const double* values) { return _mm_loadu_pd(values); };
+			const auto store = [](double* values, const Lanes lanes) { _mm_storeu_pd(values, lanes); };
+			const auto add = [](const Lanes a, const Lanes b) { return _mm_add_pd(a, b); };
+			const auto subtract = [](const Lanes a, const Lanes b) { return _mm_sub_pd(a, b); };
+			const auto multiply = [](const Lanes a, const Lanes b) { return _mm_mul_pd(a, b); };
+			const auto absolute = [](const Lanes a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); };
+			const auto above = [](const Lanes a, const Lanes b) {
+				return _mm_movemask_pd(_mm_cmpgt_pd(a, b));
+			};
+#endif
+			return LaneOffsets<Lanes>(x, y, z, count, plane, offsets, positive, negative, width,
+				set, load, store, add, subtract, multiply, absolute, above);
+		}
+
+		static size_t ArrayOffsets(const float* x, const float* y, const float* z,
+			const size_t count, const Plane& plane, float* offsets,
+			std::uint64_t* positive, std::uint64_t* negative) {
+#ifdef MESH_PLANE_INTERSECT_AVX
+			typedef __m256 Lanes;
+			const int width(8);
+			const auto set = [](const float value) { return _mm256_set1_ps(value); };
+			const auto load = [](const float* values) { return _mm256_loadu_ps(values); };
+			const auto store = [](float* values, const Lanes lanes) { _mm256_storeu_ps(values, lanes); };
+			const auto add = [](const Lanes a, const Lanes b) { return _mm256_add_ps(a, b); };
+			const auto subtract = [](const Lanes a, const Lanes b) { return _mm256_sub_ps(a, b); };
+			const auto multiply = [](const Lanes a, const Lanes b) { return _mm256_mul_ps(a, b); };
+			const auto absolute = [](const Lanes a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); };
+			const auto above = [](const Lanes a, const Lanes b) {
+				return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_GT_OQ));
+			};
+#else
+			typedef __m128 Lanes;
+			const int width(4);
+			const auto set = [](const float value) { return _mm_set1_ps(value); };
+			const auto load = [](const float* values) { return _mm_loadu_ps(values); };
+			const auto store = [](float* values, const Lanes lanes) { _mm_storeu_ps(values, lanes); };
+			const auto add = [](const Lanes a, const Lanes b) { return _mm_add_ps(a, b); };
+			const auto subtract = [](const Lanes a, const Lanes b) { return _mm_sub_ps(a, b); };
+			const auto multiply = [](const Lanes a, const Lanes b) { return _mm_mul_ps(a, b); };
+			const auto absolute = [](const Lanes a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); };
+			const auto above = [](const Lanes a, const Lanes b) {
+				return _mm_movemask_ps(_mm_cmpgt_ps(a, b));
+			};
+#endif
+			return LaneOffsets<Lanes>(x, y, z, count, plane, offsets, positive, negative, width,
+				set, load, store, add, subtract, multiply, absolute, above);
+		}
+
+		template <typename Lanes, typename Type, typename Set, typename Load, typename Store,
+			typename Add, typename Subtract, typename Multiply, typename Absolute, typename Above>
+		static size_t LaneOffsets(const Type* x, const Type* y, const Type* z,
+			const size_t count, const Plane& plane, Type* offsets,
+			std::uint64_t* positive, std::uint64_t* negative, const int width,
+			const Set& set, const Load& load, const Store& store, const Add& add,
+			const Subtract& subtract, const Multiply& multiply, const Absolute& absolute,
+			const Above& above) {
+			const std::array<const Type*, 3> coordinates{ x, y, z };
+			std::array<Lanes, 3> normal, origin;
+			for (int i(0); i < 3; ++i) {
+				normal[i] = set(static_cast<Type>(plane.normal[i]));
+				origin[i] = set(static_cast<Type>(plane.origin[i]));
+			}
+			const Lanes zero(set(0));
+			const Lanes errorFactor(set(OffsetErrorFactor()));
+			const Lanes onPlane(set(OnPlaneOffset()));
+			const int allLanes((1 << width) - 1);
+			const size_t wordCount(count / 64);
+			for (size_t iWord(0); iWord < wordCount; ++iWord) {
+				std::uint64_t positiveBits(0), negativeBits(0);
+				for (int iBit(0); iBit < 64; iBit += width) {
+					const size_t iVertex(iWord * 64 + iBit);
+					Lanes offset(zero), magnitude(zero);
+					for (int i(0); i < 3; ++i) {
+						const Lanes term(multiply(normal[i],
+							subtract(load(coordinates[i] + iVertex), origin[i])));
+						offset = add(offset, term);
+						magnitude = add(magnitude, absolute(term));
+					}
+					store(offsets + iVertex, offset);
+					// the lanes within their error bound of zero, or no further from it than
+					// OnPlaneOffset(), are refined one at a time
+					const int nearLanes(allLanes & ~(above(absolute(offset), multiply(errorFactor, magnitude)) &
+						above(absolute(offset), onPlane)));
+					if (nearLanes != 0) {
+						for (int iLane(0); iLane < width; ++iLane) {
+							if ((nearLanes >> iLane) & 1) {
+								const size_t i(iVertex + iLane);
+								offsets[i] = RefinedOffset({ x[i], y[i], z[i] }, plane, offsets[i]);
+							}
+						}
+						offset = load(offsets + iVertex);
+					}
+					positiveBits |= static_cast<std::uint64_t>(above(offset, zero)) << iBit;
+					negativeBits |= static_cast<std::uint64_t>(above(zero, offset)) << iBit;
+				}
+				positive[iWord] = positiveBits;
+				negative[iWord] = negativeBits;
+			}
+			return wordCount * 64;
+		}
+#endif
+
+		static void SetVertexSign(VertexSigns& signs, const size_t vertex, const FloatType offset) {
+			const std::uint64_t bit(static_cast<std::uint64_t>(1) << (vertex % 64));
+			auto& positive(signs.positive[vertex / 64]);
+			auto& negative(signs.negative[vertex / 64]);
+			positive = offset > 0 ? positive | bit : positive & ~bit;
+			negative = offset < 0 ? negative | bit : negative & ~bit;
+		}
+
+		// 1 above the plane or 2 below it. vertices on it count as above, see VertexOffset
+		static unsigned VertexSide(const VertexSigns& signs, const size_t vertex) {
+			const auto bit(vertex % 64);
+			return static_cast<unsigned>((signs.positive[vertex / 64] >> bit) & 1) |
+				static_cast<unsigned>(((signs.negative[vertex / 64] >> bit) & 1) << 1);
+		}
+
+		// finds the corner on its own side of the plane (oddVertex), and orders the other
+		// two so that the contour enters the face on edge v0-oddVertex and leaves it on
+		// edge oddVertex-v2
+		static bool ClassifyFace(const Face& face, const VertexSigns& vertexSigns,
+			int& v0, int& oddVertex, int& v2) {
+			const std::array<unsigned, 3> sides{ VertexSide(vertexSigns, face[0]),
+				VertexSide(vertexSigns, face[1]), VertexSide(vertexSigns, face[2]) };
+			// an edge crosses when one end is above the plane and the other below it
+			const bool edge1crosses = (sides[0] | sides[1]) == 3;
+			const bool edge2crosses = (sides[1] | sides[2]) == 3;
+			if (!edge1crosses && !edge2crosses) {
+				return false;
+			}
+			oddVertex = edge2crosses - edge1crosses + 1;
+			const bool oddIsHigher = sides[oddVertex] == 1;
+			v0 = oddVertex + 1 + oddIsHigher;
+			if (v0 > 2) {
+				v0 -= 3;
+			}
+			v2 = oddVertex + 2 - oddIsHigher;
+			if (v2 > 2) {
+				v2 -= 3;
+			}
+			return true;
+		}
+
+		// cells of the Morton curve along each axis, 21 bits each to fill 63 bits
+		static constexpr std::uint64_t mortonCells = std::uint64_t(1) << 21;
+
+		// spreads the low 21 bits of value out to every third bit
+		static std::uint64_t SpreadBits(std::uint64_t value) {
+			value &= mortonCells - 1;
+			value = (value | value << 32) & 0x1F00000000FFFFull;
+			value = (value | value << 16) & 0x1F0000FF0000FFull;
+			value = (value | value << 8) & 0x100F00F00F00F00Full;
+			value = (value | value << 4) & 0x10C30C30C30C30C3ull;
+			value = (value | value << 2) & 0x1249249249249249ull;
+			return value;
+		}
+
+		// each face edge with its half edge index, sorted so that the faces sharing an
+		// edge are adjacent
+		typedef std::pair<Edge, HalfEdgeIndex> HalfEdge;
+		static void SortedHalfEdges(const ArrayView<Face> faces, const size_t threadCount,
+			std::vector<HalfEdge>& halfEdges) {
+			halfEdges.clear();
+			halfEdges.reserve(faces.size() * 3);
+			for (size_t iFace(0); iFace < faces.size(); ++iFace) {
+				for (int iEdge(0); iEdge < 3; ++iEdge) {
+					Edge edge(static_cast<Index>(faces[iFace][iEdge]),
+						static_cast<Index>(faces[iFace][(iEdge + 1) % 3]));
+					AlignEdge(edge);
+					halfEdges.push_back({ edge, static_cast<HalfEdgeIndex>(iFace * 3 + iEdge) });
+				}
+			}
+			ParallelSort(halfEdges, threadCount, std::less<HalfEdge>());
+		}
+
+		struct TopologyArrays {
+			std::vector<HalfEdgeIndex> twins;
+			FreeEdgeIndex freeEdges;
+		};
+
+		static std::shared_ptr<const Topology> FaceTopology(const ArrayView<Face> faces,
+			const size_t threadCount) {
+			std::vector<HalfEdge> halfEdges;
+			SortedHalfEdges(faces, threadCount, halfEdges);
+			auto arrays(std::make_shared<TopologyArrays>());
+			auto& topology(*arrays);
+			topology.twins.assign(halfEdges.size(), -1);
+			for (size_t i(0); i < halfEdges.size();) {
+				size_t j(i + 1);
+				while (j < halfEdges.size() && halfEdges[j].first == halfEdges[i].first) {
+					++j;
+				}
+				if (j - i == 2) {
+					topology.twins[halfEdges[i].second] = halfEdges[i + 1].second;
+					topology.twins[halfEdges[i + 1].second] = halfEdges[i].second;
+				}
+				i = j;
+			}
+			IndexFreeEdges(halfEdges, topology.freeEdges);
+			auto view(std::make_shared<Topology>());
+			view->twins = topology.twins;
+			view->freeEdges = topology.freeEdges;
+			view->storage = arrays;
+			return view;
+		}
+
+		// a face the contour passes through, entering on the edge key and leaving on the
+		// edge from key.second to closingVertex. next and alternative are the crossing
+		// faces it may step on to, the second only if the first has been used
+		struct CrossingFace {
+			Edge key;
+			Index closingVertex;
+			Index face;
+			int entryEdge, exitEdge;
+			Index next, alternative;
+			bool isUsed;
+		};
+
+		struct HierarchyArrays {
+			std::vector<typename FaceHierarchy::Node> nodes;
+			std::vector<Index> faces;
+		};
+
+		static std::shared_ptr<const FaceHierarchy> BoundingHierarchy(
+			const ArrayView<Vec3D> vertices, const ArrayView<Face> faces) {
+			const int leafSize(8);
+			auto arrays(std::make_shared<HierarchyArrays>());
+			auto& hierarchy(*arrays);
+			std::vector<Vec3D> centroids;
+			centroids.reserve(faces.size());
+			for (const auto& face : faces) {
+				Vec3D centroid;
+				for (int i(0); i < 3; ++i) {
+					centroid[i] = (vertices[face[0]][i] + vertices[face[1]][i] +
+						vertices[face[2]][i]) / 3;
+				}
+				centroids.push_back(centroid);
+				hierarchy.faces.push_back(static_cast<Index>(hierarchy.faces.size()));
+			}
+			hierarchy.nodes.push_back({ {}, {}, 0, static_cast<Index>(faces.size()) });
+			// the nodes are split in the order they are added, so children follow parents
+			for (size_t iNode(0); iNode < hierarchy.nodes.size(); ++iNode) {
+				const Index first(hierarchy.nodes[iNode].first);
+				const Index count(hierarchy.nodes[iNode].count);
+				const auto begin(hierarchy.faces.begin() + first);
+				const auto end(begin + count);
+				Vec3D min, max, centroidMin, centroidMax;
+				min.fill(std::numeric_limits<FloatType>::max());
+				max.fill(std::numeric_limits<FloatType>::lowest());
+				centroidMin = min;
+				centroidMax = max;
+				for (auto iFace(begin); iFace != end; ++iFace) {
+					for (int i(0); i < 3; ++i) {
+						for (const auto& iVertex : faces[*iFace]) {
+							min[i] = std::min(min[i], vertices[iVertex][i]);
+							max[i] = std::max(max[i], vertices[iVertex][i]);
+						}
+						centroidMin[i] = std::min(centroidMin[i], centroids[*iFace][i]);
+						centroidMax[i] = std::max(centroidMax[i], centroids[*iFace][i]);
+					}
+				}
+				hierarchy.nodes[iNode].min = min;
+				hierarchy.nodes[iNode].max = max;
+				if (count <= leafSize) {
+					continue;
+				}
+				// split at the median centroid along the longest side
+				int axis(0);
+				for (int i(1); i < 3; ++i) {
+					if (centroidMax[i] - centroidMin[i] > centroidMax[axis] - centroidMin[axis]) {
+						axis = i;
+					}
+				}
+				std::nth_element(begin, begin + count / 2, end, [&centroids, axis](Index a, Index b) {
+					return centroids[a][axis] < centroids[b][axis];
+				});
+				hierarchy.nodes[iNode].first = static_cast<Index>(hierarchy.nodes.size());
+				hierarchy.nodes[iNode].count = 0;
+				hierarchy.nodes.push_back({ {}, {}, first, count / 2 });
+				hierarchy.nodes.push_back({ {}, {}, first + count / 2, count - count / 2 });
+			}
+			auto view(std::make_shared<FaceHierarchy>());
+			view->nodes = hierarchy.nodes;
+			view->faces = hierarchy.faces;
+			view->storage = arrays;
+			return view;
+		}
+
+		// the crossing faces found through the face hierarchy. offsets are only computed
+		// for the vertices of faces in the boxes the plane passes near
+		template <typename PlaneType>
+		static void HierarchyCrossingFaces(const Mesh& mesh, const PlaneType& plane,
+			Workspace& workspace) {
+			const Plane boxPlane(GeneralPlane(plane));
+			auto& vertexOffsets(workspace.vertexOffsets);
+			auto& vertexSigns(workspace.vertexSigns);
+			vertexOffsets.resize(mesh.vertices.size());
+			vertexSigns.positive.resize((mesh.vertices.size() + 63) / 64);
+			vertexSigns.negative.resize(vertexSigns.positive.size());
+			workspace.crossingFaces.clear();
+			const auto& nodes(mesh.faceHierarchy->nodes);
+			if (nodes.front().count == 0 && nodes.size() == 1) {
+				return;
+			}
+
+			// a box is skipped if it is further from the plane than the offsets of its
+			// vertices could be rounded by
+			FloatType normalSum(0), maxCoordinate(0);
+			for (int i(0); i < 3; ++i) {
+				normalSum += std::abs(boxPlane.normal[i]);
+				maxCoordinate = std::max({ maxCoordinate, std::abs(nodes.front().min[i]),
+					std::abs(nodes.front().max[i]), std::abs(boxPlane.origin[i]) });
+			}
+			const FloatType tolerance = 16 * std::numeric_limits<FloatType>::epsilon() *
+				normalSum * 2 * maxCoordinate;
+
+			auto& candidates(workspace.candidateFaces);
+			auto& stack(workspace.nodeStack);
+			candidates.clear();
+			stack.assign(1, 0);
+			while (!stack.empty()) {
+				const auto& node(nodes[stack.back()]);
+				stack.pop_back();
+				FloatType centreOffset(0), radius(0);
+				for (int i(0); i < 3; ++i) {
+					centreOffset += boxPlane.normal[i] * ((node.min[i] + node.max[i]) / 2 - boxPlane.origin[i]);
+					radius += std::abs(boxPlane.normal[i]) * (node.max[i] - node.min[i]) / 2;
+				}
+				if (std::abs(centreOffset) > radius + tolerance) {
+					continue;
+				}
+				if (node.count == 0) {
+					stack.push_back(node.first);
+					stack.push_back(node.first + 1);
+				}
+				else {
+					candidates.insert(candidates.end(), mesh.faceHierarchy->faces.begin() + node.first,
+						mesh.faceHierarchy->faces.begin() + node.first + node.count);
+				}
+			}
+			for (const Index iFace : candidates) {
+				for (const auto& iVertex : mesh.faces[iFace]) {
+					vertexOffsets[iVertex] = VertexOffset(mesh.vertices[iVertex], plane);
+					SetVertexSign(vertexSigns, iVertex, vertexOffsets[iVertex]);
+				}
+			}
+			for (const Index iFace : candidates) {
+				AddCrossingFace(mesh.faces, iFace, vertexSigns, workspace.crossingFaces);
+			}
+		}
+
+		// the first chunk of faces is classified straight into workspace.crossingFaces, and
+		// the others into buffers of their own that are appended to it afterwards
+		static void CrossingFaces(const ArrayView<Face> faces, const size_t threadCount,
+			Workspace& workspace) {
+			auto& chunks(workspace.crossingFaceChunks);
+			if (chunks.size() < threadCount) {
+				chunks.resize(threadCount);
+			}
+			workspace.crossingFaces.clear();
+			ParallelFor(threadCount, faces.size(), 1, [&](size_t iChunk, size_t begin, size_t end) {
+				auto& chunk(iChunk == 0 ? workspace.crossingFaces : chunks[iChunk]);
+				chunk.clear();
+				for (size_t iFace(begin); iFace < end; ++iFace) {
+					AddCrossingFace(faces, iFace, workspace.vertexSigns, chunk);
+				}
+			});
+			const size_t chunkCount(std::min(threadCount, faces.size()));
+			for (size_t iChunk(1); iChunk < chunkCount; ++iChunk) {
+				workspace.crossingFaces.insert(workspace.crossingFaces.end(),
+					chunks[iChunk].begin(), chunks[iChunk].end());
+			}
+		}
+
+		static void AddCrossingFace(const ArrayView<Face> faces, const size_t iFace,
+			const VertexSigns& vertexSigns, std::vector<CrossingFace>& crossingFaces) {
+			const auto& face(faces[iFace]);
+			int v0, oddVertex, v2;
+			if (ClassifyFace(face, vertexSigns, v0, oddVertex, v2)) {
+				crossingFaces.push_back({
+					{ static_cast<Index>(face[v0]), static_cast<Index>(face[oddVertex]) },
+					static_cast<Index>(face[v2]), static_cast<Index>(iFace),
+					FaceEdge(v0, oddVertex), FaceEdge(oddVertex, v2), -1, -1, false });
+			}
+		}
+
+		// the index within its face of the edge between two corners
+		static int FaceEdge(const int corner1, const int corner2) {
+			return (corner1 + 1) % 3 == corner2 ? corner1 : corner2;
+		}
+
+		// traces the paths through workspace.crossingFaces into workspace.edgePaths, each
+		// starting from the face with the lowest unused key. the faces are sorted and linked
+		// on separate threads, but the paths are followed in order on this one so the result
+		// doesn't depend on the thread count. with a topology, the face crossings are kept
+		// at -1 for every face between queries
+		static void EdgePaths(const Topology* topology, const size_t faceCount,
+			const size_t threadCount, Workspace& workspace) {
+			auto& crossingFaces(workspace.crossingFaces);
+			auto& faceCrossings(workspace.faceCrossings);
+			if (topology && faceCrossings.size() != faceCount) {
+				faceCrossings.assign(faceCount, -1);
+			}
+			// faces sharing a key stay in mesh order however they were found
+			ParallelSort(crossingFaces, threadCount,
+				[](const CrossingFace& a, const CrossingFace& b) {
+					return a.key < b.key || (a.key == b.key && a.face < b.face);
+				});
+			ParallelFor(threadCount, crossingFaces.size(), 1, [&](size_t, size_t begin, size_t end) {
+				for (size_t i(begin); i < end; ++i) {
+					// only the first face with a given key is used
+					crossingFaces[i].isUsed = i > 0 && crossingFaces[i].key == crossingFaces[i - 1].key;
+					if (topology) {
+						faceCrossings[crossingFaces[i].face] = static_cast<Index>(i);
+					}
+				}
+			});
+			ParallelFor(threadCount, crossingFaces.size(), 1, [&](size_t, size_t begin, size_t end) {
+				for (size_t i(begin); i < end; ++i) {
+					LinkCrossingFace(topology, crossingFaces, faceCrossings, crossingFaces[i]);
+				}
+			});
+
+			ClearPaths(workspace.edgePaths);
+			for (auto& crossingFace : crossingFaces) {
+				if (!crossingFace.isUsed) {
+					if (IsCancelled(workspace)) {
+						break;
+					}
+					GetEdgePath(crossingFaces, crossingFace, workspace.edgePaths);
+				}
+			}
+			if (topology) {
+				for (const auto& crossingFace : crossingFaces) {
+					faceCrossings[crossingFace.face] = -1;
+				}
+			}
+			// only once the face crossings are back at -1
+			CheckCancelled(workspace);
+		}
+
+		static void LinkCrossingFace(const Topology* topology,
+			const std::vector<CrossingFace>& crossingFaces, const std::vector<Index>& faceCrossings,
+			CrossingFace& crossingFace) {
+			if (topology) {
+				// the neighbour across the exit edge, if the contour enters it there
+				const HalfEdgeIndex twin(topology->twins[
+					static_cast<HalfEdgeIndex>(crossingFace.face) * 3 + crossingFace.exitEdge]);
+				const Index iNext(twin < 0 ? -1 : faceCrossings[static_cast<size_t>(twin / 3)]);
+				if (iNext >= 0 && crossingFaces[iNext].entryEdge == twin % 3) {
+					crossingFace.next = iNext;
+				}
+			}
+			else {
+				// the face keyed on the exit edge in either direction
+				const Edge exit(crossingFace.key.second, crossingFace.closingVertex);
+				crossingFace.next = FindCrossingFace(crossingFaces, exit);
+				crossingFace.alternative = FindCrossingFace(crossingFaces, { exit.second, exit.first });
+			}
+		}
+
+		static Index FindCrossingFace(const std::vector<CrossingFace>& crossingFaces,
+			const Edge& key) {
+			const auto found(std::lower_bound(crossingFaces.begin(), crossingFaces.end(), key,
+				[](const CrossingFace& crossingFace, const Edge& key) {
+					return crossingFace.key < key;
+				}));
+			return found != crossingFaces.end() && found->key == key ?
+				static_cast<Index>(found - crossingFaces.begin()) : -1;
+		}
+
+		static void GetEdgePath(std::vector<CrossingFace>& crossingFaces,
+			CrossingFace& startFace, EdgePathList& edgePaths) {
+			auto& edges(edgePaths.edges);
+			const size_t start(edges.size());
+			CrossingFace* currentFace(&startFace);
+			currentFace->isUsed = true;
+			edges.push_back(currentFace->key);
+			Index closingVertex(currentFace->closingVertex);
+			while (GetNextFace(crossingFaces, currentFace)) {
+				edges.push_back(currentFace->key);
+				closingVertex = currentFace->closingVertex;
+			}
+			edges.push_back({ edges.back().second, closingVertex });
+			for (size_t i(start); i < edges.size(); ++i) {
+				AlignEdge(edges[i]);
+			}
+			EndPath(edgePaths);
+		}
+
+		static bool GetNextFace(std::vector<CrossingFace>& crossingFaces,
+			CrossingFace*& currentFace) {
+			for (const Index iNext : { currentFace->next, currentFace->alternative }) {
+				if (iNext >= 0 && !crossingFaces[iNext].isUsed) {
+					currentFace = &crossingFaces[iNext];
+					currentFace->isUsed = true;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		static void AlignEdge(Edge& edge) {
+			if (edge.first > edge.second) {
+				std::swap(edge.first, edge.second);
+			}
+		}
+
+		// the paths ending on each edge, in path order, so that the first unused path
+		// joining a chain is found without scanning every path. the edges are kept in an
+		// open addressed hash table whose entries are slot numbers, or -1 when empty
+		struct EndpointIndex {
+			std::vector<Index> table;
+			std::vector<EdgeKey> slotKeys;
+			std::vector<size_t> slotStarts, slotCursors;
+			std::vector<Index> paths, pathSlots;
+			// slots looked at while chaining
+			size_t probes = 0;
+		};
+
+		// the slot of an edge, added if it isn't there yet and 'add' is set, otherwise -1
+		static Index EndpointSlot(EndpointIndex& index, const Edge& edge, const bool add) {
+			const size_t mask(index.table.size() - 1);
+			const EdgeKey key(Key(edge));
+			for (size_t i(EdgeHash()(key) & mask);; i = (i + 1) & mask) {
+				Count(index.probes, 1);
+				const Index slot(index.table[i]);
+				if (slot < 0) {
+					if (!add) {
+						return -1;
+					}
+					index.table[i] = static_cast<Index>(index.slotKeys.size());
+					index.slotKeys.push_back(key);
+					return index.table[i];
+				}
+				if (index.slotKeys[slot] == key) {
+					return slot;
+				}
+			}
+		}
+
+		static void IndexEndpoints(const EdgePathList& edgePaths, EndpointIndex& index) {
+			const size_t pathCount(PathCount(edgePaths));
+			// at most half full
+			size_t tableSize(1);
+			while (tableSize < pathCount * 4) {
+				tableSize *= 2;
+			}
+			index.table.assign(tableSize, -1);
+			index.slotKeys.clear();
+			index.pathSlots.clear();
+			for (size_t iPath(0); iPath < pathCount; ++iPath) {
+				index.pathSlots.push_back(EndpointSlot(index,
+					edgePaths.edges[edgePaths.starts[iPath]], true));
+				index.pathSlots.push_back(EndpointSlot(index,
+					edgePaths.edges[edgePaths.starts[iPath + 1] - 1], true));
+			}
+			const auto& pathSlots(index.pathSlots);
+			index.slotStarts.assign(index.slotKeys.size() + 1, 0);
+			for (size_t i(0); i < pathSlots.size(); ++i) {
+				// a closed path is only listed once under its end edge
+				if (i % 2 == 0 || pathSlots[i] != pathSlots[i - 1]) {
+					++index.slotStarts[pathSlots[i] + 1];
+				}
+			}
+			for (size_t i(1); i < index.slotStarts.size(); ++i) {
+				index.slotStarts[i] += index.slotStarts[i - 1];
+			}
+			index.paths.resize(index.slotStarts.back());
+			index.slotCursors.assign(index.slotStarts.begin(), index.slotStarts.end() - 1);
+			for (size_t i(0); i < pathSlots.size(); ++i) {
+				if (i % 2 == 0 || pathSlots[i] != pathSlots[i - 1]) {
+					index.paths[index.slotCursors[pathSlots[i]]++] = static_cast<Index>(i / 2);
+				}
+			}
+			index.slotCursors.assign(index.slotStarts.begin(), index.slotStarts.end() - 1);
+		}
+
+		static Index FirstUnusedPath(EndpointIndex& index, const Edge& end,
+			const std::vector<bool>& usedPaths) {
+			const Index slot(EndpointSlot(index, end, false));
+			if (slot < 0) {
+				return -1;
+			}
+			auto& cursor(index.slotCursors[slot]);
+			const auto slotEnd(index.slotStarts[slot + 1]);
+			while (cursor < slotEnd && usedPaths[index.paths[cursor]]) {
+				++cursor;
+			}
+			return cursor < slotEnd ? index.paths[cursor] : -1;
+		}
+
+		// a chain is built up from its first path by adding paths to either end. rather
+		// than moving edges around as it grows, the paths added are listed and only copied
+		// out once it is complete. each path added leaves out the edge it shares with the
+		// chain, which is its first one in the order it is added in, or its last one for
+		// paths added to the front
+		struct ChainLink {
+			Index path;
+			bool isReversed;
+		};
+		struct EdgePathChain {
+			Edge front, back;
+			std::vector<ChainLink> frontLinks, backLinks;
+		};
+
+		static bool InsertConnectingEdgePath(const EdgePathList& edgePaths,
+			EndpointIndex& endpoints, std::vector<bool>& usedPaths, EdgePathChain& chain) {
+			// the lowest numbered unused path touching either end of the chain
+			const Index iBack(FirstUnusedPath(endpoints, chain.back, usedPaths));
+			const Index iFront(FirstUnusedPath(endpoints, chain.front, usedPaths));
+			if (iBack < 0 && iFront < 0) {
+				return false;
+			}
+			const Index iPath(iBack < 0 ? iFront : iFront < 0 ? iBack : std::min(iBack, iFront));
+			const auto& pathFront(edgePaths.edges[edgePaths.starts[iPath]]);
+			const auto& pathBack(edgePaths.edges[edgePaths.starts[iPath + 1] - 1]);
+			if (pathFront == chain.back) {
+				chain.backLinks.push_back({ iPath, false });
+				chain.back = pathBack;
+			}
+			else if (pathBack == chain.back) {
+				chain.backLinks.push_back({ iPath, true });
+				chain.back = pathFront;
+			}
+			else if (pathBack == chain.front) {
+				chain.frontLinks.push_back({ iPath, false });
+				chain.front = pathFront;
+			}
+			else {
+				chain.frontLinks.push_back({ iPath, true });
+				chain.front = pathBack;
+			}
+
+			usedPaths[iPath] = true;
+			return true;
+		}
+
+		// appends the edges of a path in the order given, less the first and last 'skip'
+		static void AppendEdges(const EdgePathList& edgePaths, const ChainLink& link,
+			const size_t skipFirst, const size_t skipLast, std::vector<Edge>& edges) {
+			const size_t begin(edgePaths.starts[link.path]);
+			const size_t count(edgePaths.starts[link.path + 1] - begin);
+			for (size_t i(skipFirst); i + skipLast < count; ++i) {
+				edges.push_back(edgePaths.edges[link.isReversed ? begin + count - 1 - i : begin + i]);
+			}
+		}
+
+		// whether every edge of the path runs from the same vertex on the plane, whose
+		// points would all be that vertex. such a path is what is left of a vertex the
+		// plane only touches
+		static bool IsPointPath(const Edge* begin, const Edge* end,
+			const std::vector<FloatType>& vertexOffsets) {
+			for (const Index vertex : { begin->first, begin->second }) {
+				if (vertexOffsets[vertex] != OnPlaneOffset()) {
+					continue;
+				}
+				auto edge(begin);
+				while (edge != end && edge->first != edge->second &&
+					(edge->first == vertex || edge->second == vertex)) {
+					++edge;
+				}
+				if (edge == end) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// joins the paths in workspace.edgePaths that share end edges into
+		// workspace.chainedPaths, leaving out those that are only a point
+		static void ChainEdgePaths(Workspace& workspace) {
+			const auto& edgePaths(workspace.edgePaths);
+			auto& chainedPaths(workspace.chainedPaths);
+			auto& usedPaths(workspace.usedPaths);
+			auto& chain(workspace.chain);
+			ClearPaths(chainedPaths);
+			workspace.endpoints.probes = 0;
+			const size_t pathCount(PathCount(edgePaths));
+			if (pathCount < 1) {
+				return;
+			}
+			IndexEndpoints(edgePaths, workspace.endpoints);
+			usedPaths.assign(pathCount, false);
+			for (size_t iStart(0); iStart < pathCount; ++iStart) {
+				if (usedPaths[iStart]) {
+					continue;
+				}
+				CheckCancelled(workspace);
+				usedPaths[iStart] = true;
+				chain.front = edgePaths.edges[edgePaths.starts[iStart]];
+				chain.back = edgePaths.edges[edgePaths.starts[iStart + 1] - 1];
+				chain.frontLinks.clear();
+				chain.backLinks.clear();
+				while (InsertConnectingEdgePath(edgePaths, workspace.endpoints, usedPaths, chain)) {}
+				// the last path added to the front comes first
+				for (auto link(chain.frontLinks.rbegin()); link != chain.frontLinks.rend(); ++link) {
+					AppendEdges(edgePaths, *link, 0, 1, chainedPaths.edges);
+				}
+				AppendEdges(edgePaths, { static_cast<Index>(iStart), false }, 0, 0, chainedPaths.edges);
+				for (const auto& link : chain.backLinks) {
+					AppendEdges(edgePaths, link, 1, 0, chainedPaths.edges);
+				}
+				const auto& edges(chainedPaths.edges);
+				if (IsPointPath(edges.data() + chainedPaths.starts.back(), edges.data() + edges.size(),
+					workspace.vertexOffsets)) {
+					chainedPaths.edges.resize(chainedPaths.starts.back());
+					continue;
+				}
+				EndPath(chainedPaths);
+			}
+		}
+
+		static void IndexFreeEdges(const std::vector<HalfEdge>& halfEdges, FreeEdgeIndex& index) {
+			index.edges.clear();
+			index.edgeEnds.clear();
+			index.vertices.clear();
+			for (size_t i(0); i < halfEdges.size(); ++i) {
+				if ((i == 0 || halfEdges[i - 1].first != halfEdges[i].first) &&
+					(i + 1 == halfEdges.size() || halfEdges[i + 1].first != halfEdges[i].first)) {
+					index.edges.push_back(halfEdges[i].first);
+				}
+			}
+			for (const auto& edge : index.edges) {
+				index.vertices.push_back(edge.first);
+				index.vertices.push_back(edge.second);
+			}
+			std::sort(index.vertices.begin(), index.vertices.end());
+			index.vertices.erase(std::unique(index.vertices.begin(), index.vertices.end()),
+				index.vertices.end());
+			const auto vertexNumber = [&index](const Index vertex) {
+				return static_cast<Index>(std::lower_bound(index.vertices.begin(),
+					index.vertices.end(), vertex) - index.vertices.begin());
+			};
+
+			auto& starts(index.vertexStarts);
+			starts.assign(index.vertices.size() + 1, 0);
+			for (const auto& edge : index.edges) {
+				index.edgeEnds.push_back({ vertexNumber(edge.first), vertexNumber(edge.second) });
+				++starts[index.edgeEnds.back().first + 1];
+				++starts[index.edgeEnds.back().second + 1];
+			}
+			for (size_t i(1); i < starts.size(); ++i) {
+				starts[i] += starts[i - 1];
+			}
+			// each start is moved on past its edges as they are filled in, which leaves it
+			// on the start of the next vertex, then they are all moved back one
+			index.vertexEdges.resize(starts.back());
+			for (size_t iEdge(0); iEdge < index.edgeEnds.size(); ++iEdge) {
+				index.vertexEdges[starts[index.edgeEnds[iEdge].first]++] = static_cast<Index>(iEdge);
+				index.vertexEdges[starts[index.edgeEnds[iEdge].second]++] = static_cast<Index>(iEdge);
+			}
+			for (size_t i(starts.size() - 1); i > 0; --i) {
+				starts[i] = starts[i - 1];
+			}
+			starts[0] = 0;
+		}
+
+		// the free edges are joined as before, each path starting from the first unused
+		// edge and extended by the first unused edge at either end, but the edges at an
+		// end are looked up rather than searched for. the vertices are those of
+		// frontVertices from last to first, then those of backVertices, which always has
+		// the first
+		struct FreeEdgePath {
+			Index StartEdge, EndEdge;
+			std::vector<Index> frontVertices, backVertices;
+		};
+
+		static Index FrontVertex(const FreeEdgePath& path) {
+			return path.frontVertices.empty() ? path.backVertices.front() : path.frontVertices.back();
+		}
+
+		// adds the paths around the free edges above the plane to workspace.edgePaths
+		static void FreeEdgePaths(const FreeEdgeView& index,
+			const std::vector<FloatType>& vertexOffsets, Workspace& workspace) {
+			// edges below the plane are left out
+			auto& usedEdges(workspace.usedEdges);
+			usedEdges.resize(index.edges.size());
+			for (size_t iEdge(0); iEdge < index.edges.size(); ++iEdge) {
+				usedEdges[iEdge] = vertexOffsets[index.edges[iEdge].first] < 0 &&
+					vertexOffsets[index.edges[iEdge].second] < 0;
+			}
+			auto& vertexCursors(workspace.vertexCursors);
+			vertexCursors.assign(index.vertexStarts.begin(), index.vertexStarts.end() - 1);
+			auto& path(workspace.freeEdgePath);
+			auto& edgePaths(workspace.edgePaths);
+			for (size_t iStart(0); iStart < index.edges.size(); ++iStart) {
+				if (usedEdges[iStart]) {
+					continue;
+				}
+				usedEdges[iStart] = true;
+				const auto& edge(index.edgeEnds[iStart]);
+				const auto& offset1(vertexOffsets[index.edges[iStart].first]);
+				const auto& offset2(vertexOffsets[index.edges[iStart].second]);
+				path.StartEdge = path.EndEdge = -1;
+				path.frontVertices.clear();
+				path.backVertices.clear();
+				if (offset1 > 0) {
+					path.backVertices.push_back(edge.first);
+					if (offset2 < 0) {
+						path.StartEdge = static_cast<Index>(iStart);
+					}
+				}
+				if (offset2 > 0) {
+					path.backVertices.push_back(edge.second);
+					if (offset1 < 0) {
+						path.EndEdge = static_cast<Index>(iStart);
+					}
+				}
+				if (path.backVertices.empty()) {
+					// the edge only touches the plane
+					continue;
+				}
+				while (ExtendFreeEdgePath(path, index, usedEdges, vertexCursors, vertexOffsets)) {
+					// chain getting longer, available edges getting smaller
+				}
+				if (path.StartEdge >= 0) {
+					edgePaths.edges.push_back(index.edges[path.StartEdge]);
+				}
+				for (auto iVert(path.frontVertices.rbegin()); iVert != path.frontVertices.rend(); ++iVert) {
+					edgePaths.edges.push_back({ index.vertices[*iVert], index.vertices[*iVert] });
+				}
+				for (const Index iVert : path.backVertices) {
+					edgePaths.edges.push_back({ index.vertices[iVert], index.vertices[iVert] });
+				}
+				if (path.EndEdge >= 0) {
+					edgePaths.edges.push_back(index.edges[path.EndEdge]);
+				}
+				EndPath(edgePaths);
+			}
+		}
+
+		static Index FirstUnusedEdge(const FreeEdgeView& index, const Index vertex,
+			const std::vector<bool>& usedEdges, std::vector<size_t>& vertexCursors) {
+			auto& cursor(vertexCursors[vertex]);
+			while (cursor < index.vertexStarts[vertex + 1] && usedEdges[index.vertexEdges[cursor]]) {
+				++cursor;
+			}
+			return cursor < index.vertexStarts[vertex + 1] ? index.vertexEdges[cursor] : -1;
+		}
+
+		static bool ExtendFreeEdgePath(FreeEdgePath& path, const FreeEdgeView& index,
+			std::vector<bool>& usedEdges, std::vector<size_t>& vertexCursors,
+			const std::vector<FloatType>& vertexOffsets) {
+			const Index iBack(path.EndEdge < 0 ?
+				FirstUnusedEdge(index, path.backVertices.back(), usedEdges, vertexCursors) : -1);
+			const Index iFront(path.StartEdge < 0 ?
+				FirstUnusedEdge(index, FrontVertex(path), usedEdges, vertexCursors) : -1);
+			if (iBack < 0 && iFront < 0) {
+				return false;
+			}
+			// the lower edge wins, and the back of the chain if it is at both ends
+			const bool isBack(iFront < 0 || (iBack >= 0 && iBack <= iFront));
+			const Index iEdge(isBack ? iBack : iFront);
+			const auto& edge(index.edgeEnds[iEdge]);
+			const bool edgeCrosses = vertexOffsets[index.edges[iEdge].first] *
+				vertexOffsets[index.edges[iEdge].second] < 0;
+			usedEdges[iEdge] = true;
+
+			// try adding to the back of the chain
+			if (isBack) {
+				if (edgeCrosses) {
+					path.EndEdge = iEdge;
+				}
+				else {
+					path.backVertices.push_back(
+						path.backVertices.back() == edge.first ? edge.second : edge.first);
+				}
+			}
+			// otherwise to the front of the chain
+			else {
+				if (edgeCrosses) {
+					path.StartEdge = iEdge;
+				}
+				else {
+					path.frontVertices.push_back(
+						FrontVertex(path) == edge.first ? edge.second : edge.first);
+				}
+			}
+			return true;
+		}
+
+	public:
+		// the buffers used by a query, which keep their memory from one query to the next.
+		// the same workspace can be passed to Intersect and Clip as many times as needed
+		class Workspace {
+			friend class Mesh;
+		public:
+			// the statistics of the last Intersect or Clip with this workspace. these are
+			// only recorded when MESH_PLANE_INTERSECT_STATISTICS is defined, and are all
+			// zero otherwise
+			const Statistics& GetStatistics() const {
+				return statistics;
+			}
+
+			// hook is called with the statistics at the end of each Intersect or Clip with
+			// this workspace, when they are recorded
+			void SetStatisticsHook(std::function<void(const Statistics&)> hook) {
+				statisticsHook = std::move(hook);
+			}
+
+			// queries with this workspace check the flag as they go, and throw Cancelled
+			// soon after another thread sets it. the flag has to outlive them, and nullptr
+			// stops the checks
+			void SetCancelFlag(const std::atomic<bool>* flag) {
+				cancelFlag = flag;
+			}
+
+			// the offset of each vertex from the plane of the last query, and the words of
+			// bits marking the vertices above and below it, 64 to a word. queries through
+			// the face hierarchy or a section only fill in those of the faces near the plane
+			const std::vector<FloatType>& GetVertexOffsets() const {
+				return vertexOffsets;
+			}
+
+			const std::vector<std::uint64_t>& GetPositiveSigns() const {
+				return vertexSigns.positive;
+			}
+
+			const std::vector<std::uint64_t>& GetNegativeSigns() const {
+				return vertexSigns.negative;
+			}
+
+		private:
+			Statistics statistics;
+			std::function<void(const Statistics&)> statisticsHook;
+			const std::atomic<bool>* cancelFlag = nullptr;
+			std::vector<FloatType> vertexOffsets;
+			VertexSigns vertexSigns;
+			std::vector<CrossingFace> crossingFaces;
+			std::vector<std::vector<CrossingFace>> crossingFaceChunks;
+			std::vector<Index> faceCrossings;
+			std::vector<Index> candidateFaces, nodeStack;
+			EdgePathList edgePaths, chainedPaths;
+			EndpointIndex endpoints;
+			std::vector<bool> usedPaths;
+			EdgePathChain chain;
+			std::vector<HalfEdge> halfEdges;
+			FreeEdgeIndex freeEdges;
+			std::vector<bool> usedEdges;
+			std::vector<size_t> vertexCursors;
+			FreeEdgePath freeEdgePath;
+			std::vector<Vec3D> pathPoints;
+			std::vector<AreaIntegrals> areaIntegrals;
+			std::vector<size_t> closedPaths;
+			std::vector<PolygonBounds> polygonBounds;
+			std::vector<Vec2D> queryPoints;
+			std::vector<int> polygonOrder, polygonQueries, activePolygons, candidatePolygons;
+			std::vector<Edge> cutKeys;
+			std::vector<Vec3D> cutPoints;
+			std::array<std::vector<Index>, 2> partNumbers, cutNumbers;
+			std::vector<Polygon2D> capPolygons;
+			std::vector<std::vector<Index>> capLoops;
+			std::vector<Vec2D> cutCoordinates;
+			std::vector<Index> capRing, capBridge;
+			std::vector<std::pair<Index, Index>> capLinks;
+		};
+
+		// intersects the mesh with planes of one normal that only move a little between
+		// queries, such as a section plane dragged through the model. the faces are sorted
+		// along the normal once, each query only adds and removes the faces the plane has
+		// moved onto or off, and the contours are traced through the faces near the plane.
+		// the results are the same as Intersect and Clip with SlicePlane(normal, offset).
+		// a new normal needs a new section, as do changes to the vertices or faces or
+		// building more for the mesh
+		class Section {
+		public:
+			Section(const Mesh& mesh, const Vec3D& normal) :
+				mesh(mesh.Current()), normal(normal) {
+				projectionPlane.normal = normal;
+				projections = VertexOffsets(mesh.vertices, projectionPlane);
+				for (const auto& vertex : mesh.vertices) {
+					for (const auto& coordinate : vertex) {
+						maxCoordinate = std::max(maxCoordinate, std::abs(coordinate));
+					}
+				}
+				for (const auto& component : normal) {
+					normalSum += std::abs(component);
+					normalMax = std::max(normalMax, std::abs(component));
+				}
+				faceExtents = FaceExtents(mesh.faces, projections);
+				facesByMin.resize(mesh.faces.size());
+				for (size_t i(0); i < facesByMin.size(); ++i) {
+					facesByMin[i] = static_cast<Index>(i);
+				}
+				facesByMax = facesByMin;
+				std::sort(facesByMin.begin(), facesByMin.end(), [this](Index a, Index b) {
+					return faceExtents[a].first < faceExtents[b].first;
+				});
+				std::sort(facesByMax.begin(), facesByMax.end(), [this](Index a, Index b) {
+					return faceExtents[a].second < faceExtents[b].second;
+				});
+				isUnderTop.resize(mesh.faces.size());
+				isUnderBottom.resize(mesh.faces.size());
+				activePositions.assign(mesh.faces.size(), -1);
+				vertexQueries.assign(mesh.vertices.size(), 0);
+			}
+
+			std::vector<Path3D> Intersect(const FloatType offset) {
+				std::vector<Path3D> result;
+				Intersect(offset, result);
+				return result;
+			}
+
+			std::vector<Path3D> Clip(const FloatType offset) {
+				std::vector<Path3D> result;
+				Clip(offset, result);
+				return result;
+			}
+
+			// the paths are written over the ones already in result
+			void Intersect(const FloatType offset, std::vector<Path3D>& result) {
+				Execute(offset, false, result);
+			}
+
+			void Clip(const FloatType offset, std::vector<Path3D>& result) {
+				Execute(offset, true, result);
+			}
+
+			// see Workspace::SetCancelFlag
+			void SetCancelFlag(const std::atomic<bool>* flag) {
+				workspace.SetCancelFlag(flag);
+			}
+
+		private:
+			const Mesh mesh;
+			const Vec3D normal;
+			Plane projectionPlane;
+			std::vector<FloatType> projections;
+			FloatType maxCoordinate = 0, normalSum = 0, normalMax = 0;
+			std::vector<std::pair<FloatType, FloatType>> faceExtents;
+
+			// the faces are active while their extents overlap the band around the plane,
+			// which is while they are among the first minCount by their lowest projection,
+			// but not the first maxCount by their highest
+			std::vector<Index> facesByMin, facesByMax;
+			size_t minCount = 0, maxCount = 0;
+			std::vector<bool> isUnderTop, isUnderBottom;
+			std::vector<Index> activeFaces, activePositions;
+
+			// the vertex offsets are worked out once per query, which is numbered
+			std::vector<size_t> vertexQueries;
+			size_t query = 0;
+			FreeEdgeIndex freeEdges;
+			Workspace workspace;
+
+			void Execute(const FloatType offset, const bool isClip, std::vector<Path3D>& result) {
+				// the projection of each vertex onto the normal differs from its offset to
+				// the plane only by rounding, so widen the band by a bound on that
+				const Plane plane(SlicePlane(normal, offset));
+				const FloatType key(PlaneOffset(plane.origin, projectionPlane));
+				const FloatType tolerance = 16 * std::numeric_limits<FloatType>::epsilon() *
+					normalSum * (maxCoordinate + normalMax * std::abs(offset));
+				MoveBand(key - tolerance, key + tolerance);
+
+				// only the first face with a given key is used, so visit the active faces in
+				// mesh order to match Intersect exactly
+				auto& candidates(workspace.candidateFaces);
+				candidates.assign(activeFaces.begin(), activeFaces.end());
+				std::sort(candidates.begin(), candidates.end());
+				auto& vertexOffsets(workspace.vertexOffsets);
+				auto& vertexSigns(workspace.vertexSigns);
+				vertexOffsets.resize(mesh.vertices.size());
+				vertexSigns.positive.resize((mesh.vertices.size() + 63) / 64);
+				vertexSigns.negative.resize(vertexSigns.positive.size());
+				++query;
+				for (const Index iFace : candidates) {
+					for (const auto& iVertex : mesh.faces[iFace]) {
+						if (vertexQueries[iVertex] != query) {
+							vertexQueries[iVertex] = query;
+							vertexOffsets[iVertex] = VertexOffset(mesh.vertices[iVertex], plane);
+							SetVertexSign(vertexSigns, iVertex, vertexOffsets[iVertex]);
+						}
+					}
+				}
+				workspace.crossingFaces.clear();
+				for (const Index iFace : candidates) {
+					AddCrossingFace(mesh.faces, iFace, vertexSigns, workspace.crossingFaces);
+				}
+				EdgePaths(mesh.topology.get(), mesh.faces.size(), 1, workspace);
+				if (isClip) {
+					if (!mesh.topology && freeEdges.vertexStarts.empty()) {
+						SortedHalfEdges(mesh.faces, 1, workspace.halfEdges);
+						IndexFreeEdges(workspace.halfEdges, freeEdges);
+					}
+					const FreeEdgeView meshFreeEdges(mesh.topology ? mesh.topology->freeEdges :
+						FreeEdgeView(freeEdges));
+					for (const Index iVertex : meshFreeEdges.vertices) {
+						vertexOffsets[iVertex] = VertexOffset(mesh.vertices[iVertex], plane);
+					}
+					FreeEdgePaths(meshFreeEdges, vertexOffsets, workspace);
+				}
+				ChainEdgePaths(workspace);
+				ConstructGeometricPaths(mesh, plane, workspace.chainedPaths, vertexOffsets, 1, result);
+			}
+
+			// moves the counts to the faces below top and bottom, updating only the faces
+			// passed over
+			void MoveBand(const FloatType bottom, const FloatType top) {
+				while (minCount < facesByMin.size() &&
+					faceExtents[facesByMin[minCount]].first < top) {
+					isUnderTop[facesByMin[minCount]] = true;
+					UpdateFace(facesByMin[minCount++]);
+				}
+				while (minCount > 0 && !(faceExtents[facesByMin[minCount - 1]].first < top)) {
+					isUnderTop[facesByMin[--minCount]] = false;
+					UpdateFace(facesByMin[minCount]);
+				}
+				while (maxCount < facesByMax.size() &&
+					faceExtents[facesByMax[maxCount]].second <= bottom) {
+					isUnderBottom[facesByMax[maxCount]] = true;
+					UpdateFace(facesByMax[maxCount++]);
+				}
+				while (maxCount > 0 && !(faceExtents[facesByMax[maxCount - 1]].second <= bottom)) {
+					isUnderBottom[facesByMax[--maxCount]] = false;
+					UpdateFace(facesByMax[maxCount]);
+				}
+			}
+
+			void UpdateFace(const Index iFace) {
+				const bool isActive(isUnderTop[iFace] && !isUnderBottom[iFace]);
+				auto& position(activePositions[iFace]);
+				if (isActive && position < 0) {
+					position = static_cast<Index>(activeFaces.size());
+					activeFaces.push_back(iFace);
+				}
+				else if (!isActive && position >= 0) {
+					activeFaces[position] = activeFaces.back();
+					activePositions[activeFaces.back()] = position;
+					activeFaces.pop_back();
+					position = -1;
+				}
+			}
+		};
+
+		// a Slice running on a thread of its own, started by SliceAsync. destroying a job
+		// that is still running cancels it and waits for it to stop
+		class SliceJob {
+			friend class Mesh;
+		public:
+			SliceJob(SliceJob&&) = default;
+			SliceJob& operator=(SliceJob&&) = delete;
+
+			~SliceJob() {
+				if (thread.joinable()) {
+					Cancel();
+					thread.join();
+				}
+			}
+
+			size_t LayerCount() const {
+				return state->layerCount;
+			}
+
+			// the layers finished so far, each reported to onLayer before it is counted
+			size_t LayersDone() const {
+				return state->layersDone;
+			}
+
+			// asks the job to stop, which it does within the layer it is on. can be called
+			// from any thread
+			void Cancel() {
+				state->isCancelled = true;
+			}
+
+			// whether the job has finished, stopped or failed, so that Get won't wait
+			bool IsDone() const {
+				return state->isDone;
+			}
+
+			// waits for the job and returns all of the layers, as Slice would. throws
+			// Cancelled if it was cancelled first, or whatever else stopped it. can only be
+			// called once
+			std::vector<std::vector<Path3D>> Get() {
+				return result.get();
+			}
+
+		private:
+			struct State {
+				size_t layerCount = 0;
+				std::atomic<size_t> layersDone{ 0 };
+				std::atomic<bool> isCancelled{ false }, isDone{ false };
+			};
+			std::shared_ptr<State> state;
+			std::future<std::vector<std::vector<Path3D>>> result;
+			std::thread thread;
+
+			// the job has its own copy of the mesh, which refers to the same vertices and
+			// faces
+			SliceJob(const Mesh& mesh, const Vec3D& normal, const std::vector<FloatType>& offsets,
+				std::function<void(size_t, const std::vector<Path3D>&)> onLayer) :
+				state(std::make_shared<State>()) {
+				state->layerCount = offsets.size();
+				std::promise<std::vector<std::vector<Path3D>>> promise;
+				result = promise.get_future();
+				thread = std::thread([mesh, normal, offsets, onLayer, state = state,
+					promise = std::move(promise)]() mutable {
+					try {
+						promise.set_value(_Slice(mesh, normal, offsets, &state->isCancelled,
+							[&](size_t iLayer, const std::vector<Path3D>& paths) {
+								if (onLayer) {
+									onLayer(iLayer, paths);
+								}
+								++state->layersDone;
+							}));
+					}
+					catch (...) {
+						promise.set_exception(std::current_exception());
+					}
+					state->isDone = true;
+				});
+			}
+		};
 	};
 
 private:
@@ -1,9 +1,67 @@
 #define CATCH_CONFIG_MAIN
 #include "catch2/catch.hpp"
 #include "MeshPlaneIntersect.hpp"
+#include "MappedMeshFile.hpp"
+#include "MeshCacheFile.hpp"
+#include "MeshLoader.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
 
 typedef MeshPlaneIntersect<double, int> Intersector;
 
+static void WavyGrid(const int columns, const int rows,
+	std::vector<Intersector::Vec3D>& vertices, std::vector<Intersector::Face>& faces) {
+	for (int row(0); row < rows; ++row) {
+		for (int column(0); column < columns; ++column) {
+			vertices.push_back({ double(column), double(row),
+				std::sin(column * 0.3) * std::cos(row * 0.2) });
+		}
+	}
+	for (int row(0); row + 1 < rows; ++row) {
+		for (int column(0); column + 1 < columns; ++column) {
+			const int corner(row * columns + column);
+			faces.push_back({ corner, corner + 1, corner + columns + 1 });
+			faces.push_back({ corner, corner + columns + 1, corner + columns });
+		}
+	}
+}
+
+// the surface of the cube from 0 to n on each axis, with an n by n grid of vertices
+// on each side and the faces wound outwards
+static void GridCube(const int n, std::vector<Intersector::Vec3D>& vertices,
+	std::vector<Intersector::Face>& faces) {
+	std::map<Intersector::Vec3D, int> numbers;
+	const auto vertex = [&](const Intersector::Vec3D& point) {
+		const auto found(numbers.insert({ point, static_cast<int>(vertices.size()) }));
+		if (found.second) {
+			vertices.push_back(point);
+		}
+		return found.first->second;
+	};
+	for (int axis(0); axis < 3; ++axis) {
+		for (const int side : { 0, n }) {
+			const int u(side == 0 ? (axis + 2) % 3 : (axis + 1) % 3);
+			const int v(side == 0 ? (axis + 1) % 3 : (axis + 2) % 3);
+			const auto corner = [&](const int i, const int j) {
+				Intersector::Vec3D point;
+				point[axis] = side;
+				point[u] = i;
+				point[v] = j;
+				return vertex(point);
+			};
+			for (int i(0); i < n; ++i) {
+				for (int j(0); j < n; ++j) {
+					faces.push_back({ corner(i, j), corner(i + 1, j), corner(i + 1, j + 1) });
+					faces.push_back({ corner(i, j), corner(i + 1, j + 1), corner(i, j + 1) });
+				}
+			}
+		}
+	}
+}
+
 
 SCENARIO("Open meshes intersections work as expected") {
 
@@ -452,3 +510,1689 @@ SCENARIO("Open meshes intersections work as expected") {
 		}
 	}
 };
+
+SCENARIO("Slicing with a stack of parallel planes") {
+
+	GIVEN("a double pyramid mesh")
+	{
+		std::vector<Intersector::Vec3D> vertices{
+			{-2,-1,-1},
+			{-2,1,-1},
+			{0,-1,-1},
+			{0,1,-1},
+			{2,-1,-1},
+			{2,1,-1},
+			{-1,0,1},
+			{1,0,1}
+		};
+
+		std::vector<Intersector::Face> faces{
+			{0,1,6},
+			{1,3,6},
+			{3,2,6},
+			{2,0,6},
+			{2,3,7},
+			{3,5,7},
+			{7,5,4},
+			{2,7,4}
+		};
+
+		Intersector::Mesh mesh(vertices, faces);
+
+		WHEN("we slice along positive z") {
+			Intersector::Vec3D normal{ 0,0,1 };
+			auto layers = mesh.Slice(normal, -1.5, 0.5, 6);
+			REQUIRE(layers.size() == 6);
+			THEN("each layer matches a single intersection") {
+				for (size_t i(0); i < layers.size(); ++i) {
+					auto plane = Intersector::Mesh::SlicePlane(normal, -1.5 + 0.5 * i);
+					auto result = mesh.Intersect(plane);
+					REQUIRE(layers[i].size() == result.size());
+					for (size_t j(0); j < result.size(); ++j) {
+						REQUIRE(layers[i][j].points == result[j].points);
+						REQUIRE(layers[i][j].isClosed == result[j].isClosed);
+					}
+				}
+			}
+			THEN("only the layers inside the mesh have paths") {
+				REQUIRE(layers[0].size() == 0);
+				REQUIRE(layers[3].size() == 2);
+				REQUIRE(layers[5].size() == 0);
+			}
+		}
+	}
+}
+
+SCENARIO("Slicing on a thread of its own, and cancelling queries") {
+
+	GIVEN("a wavy grid") {
+		std::vector<Intersector::Vec3D> vertices;
+		std::vector<Intersector::Face> faces;
+		WavyGrid(80, 60, vertices, faces);
+		Intersector::Mesh mesh(vertices, faces);
+		mesh.BuildTopology();
+		std::vector<double> offsets;
+		for (int i(0); i < 40; ++i) {
+			offsets.push_back(0.9 - i * 0.045);
+		}
+
+		WHEN("we slice it asynchronously") {
+			std::vector<size_t> reported;
+			std::vector<std::vector<Intersector::Path3D>> received(offsets.size());
+			auto job(mesh.SliceAsync({ 0,0,1 }, offsets,
+				[&](size_t iLayer, const std::vector<Intersector::Path3D>& paths) {
+					reported.push_back(iLayer);
+					received[iLayer] = paths;
+				}));
+			const auto layers(job.Get());
+			const auto expected(mesh.Slice({ 0,0,1 }, offsets));
+
+			THEN("the layers are the same as from Slice") {
+				REQUIRE(layers.size() == expected.size());
+				for (size_t i(0); i < layers.size(); ++i) {
+					REQUIRE(layers[i].size() == expected[i].size());
+					for (size_t j(0); j < layers[i].size(); ++j) {
+						REQUIRE(layers[i][j].points == expected[i][j].points);
+						REQUIRE(received[i][j].points == expected[i][j].points);
+					}
+				}
+			}
+			THEN("each layer was reported in order of increasing offset") {
+				REQUIRE(job.LayerCount() == offsets.size());
+				REQUIRE(job.LayersDone() == offsets.size());
+				REQUIRE(reported.size() == offsets.size());
+				for (size_t i(0); i < reported.size(); ++i) {
+					REQUIRE(reported[i] == offsets.size() - 1 - i);
+				}
+			}
+		}
+
+		WHEN("we cancel the slicing after the first layer") {
+			std::atomic<bool> isStarted(false);
+			auto job(mesh.SliceAsync({ 0,0,1 }, offsets,
+				[&](size_t, const std::vector<Intersector::Path3D>&) {
+					isStarted = true;
+					while (isStarted) {
+						std::this_thread::yield();
+					}
+				}));
+			while (!isStarted) {
+				std::this_thread::yield();
+			}
+			job.Cancel();
+			isStarted = false;
+
+			THEN("it stops without finishing the layers") {
+				REQUIRE_THROWS_AS(job.Get(), Intersector::Cancelled);
+				REQUIRE(job.LayersDone() < offsets.size());
+				while (!job.IsDone()) {
+					std::this_thread::yield();
+				}
+			}
+		}
+
+		WHEN("the cancel flag of a workspace is set") {
+			Intersector::Plane plane;
+			plane.origin = { 0, 0, 0.1 };
+			Intersector::Mesh::Workspace workspace;
+			std::vector<Intersector::Path3D> result;
+			std::atomic<bool> isCancelled(true);
+			workspace.SetCancelFlag(&isCancelled);
+
+			THEN("the queries throw until it is cleared") {
+				REQUIRE_THROWS_AS(mesh.Intersect(plane, workspace, result), Intersector::Cancelled);
+				REQUIRE_THROWS_AS(mesh.Clip(plane, workspace, result, 2), Intersector::Cancelled);
+				isCancelled = false;
+				mesh.Clip(plane, workspace, result);
+				const auto expected(mesh.Clip(plane));
+				REQUIRE(result.size() == expected.size());
+				for (size_t i(0); i < result.size(); ++i) {
+					REQUIRE(result[i].points == expected[i].points);
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("Precomputed topology gives the same intersections") {
+
+	GIVEN("a double pyramid mesh with one external and one internal face missing")
+	{
+		std::vector<Intersector::Vec3D> vertices{
+			{-2,-1,-1},
+			{-2,1,-1},
+			{0,-1,-1},
+			{0,1,-1},
+			{2,-1,-1},
+			{2,1,-1},
+			{-1,0,1},
+			{1,0,1}
+		};
+
+		std::vector<Intersector::Face> faces{
+			{0,1,6},
+			{1,3,6},
+			{2,0,6},
+			{2,3,7},
+			{3,5,7},
+			{2,7,4}
+		};
+
+		Intersector::Mesh mesh(vertices, faces);
+		Intersector::Mesh topologyMesh(vertices, faces);
+		topologyMesh.BuildTopology();
+
+		WHEN("we intersect and clip both meshes with the plane") {
+			for (double normalZ : { 1.0, -1.0 }) {
+				Intersector::Plane plane;
+				plane.normal = { 0,0,normalZ };
+				for (bool isClip : { false, true }) {
+					auto expected = isClip ? mesh.Clip(plane) : mesh.Intersect(plane);
+					auto result = isClip ? topologyMesh.Clip(plane) : topologyMesh.Intersect(plane);
+					REQUIRE(result.size() == expected.size());
+					for (size_t i(0); i < result.size(); ++i) {
+						REQUIRE(result[i].points == expected[i].points);
+						REQUIRE(result[i].isClosed == expected[i].isClosed);
+					}
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("Contours traced in many pieces are chained back together") {
+
+	GIVEN("a wavy grid mesh with its rows numbered against the direction of the contours") {
+		const int columns(60), rows(40);
+		std::vector<Intersector::Vec3D> vertices, reversedVertices;
+		std::vector<Intersector::Face> faces;
+		WavyGrid(columns, rows, vertices, faces);
+		// each face crossing the plane then starts a piece of its own, which is joined to
+		// the pieces on either side of it
+		const auto number = [&](const int vertex) {
+			return (rows - 1 - vertex / columns) * columns + vertex % columns;
+		};
+		reversedVertices.resize(vertices.size());
+		for (int i(0); i < static_cast<int>(vertices.size()); ++i) {
+			reversedVertices[number(i)] = vertices[i];
+		}
+		std::vector<Intersector::Face> reversedFaces(faces);
+		for (auto& face : reversedFaces) {
+			for (auto& vertex : face) {
+				vertex = number(vertex);
+			}
+		}
+		Intersector::Mesh mesh(vertices, faces);
+		Intersector::Mesh reversed(reversedVertices, reversedFaces);
+		Intersector::Mesh reversedTopology(reversedVertices, reversedFaces);
+		reversedTopology.BuildTopology();
+
+		WHEN("we intersect and clip them across the rows") {
+			THEN("each contour comes out whole, the same as with the usual numbering") {
+				Intersector::Mesh::Workspace workspace;
+				std::vector<Intersector::Path3D> result;
+				for (int column(0); column + 1 < columns; column += 7) {
+					Intersector::Plane plane;
+					plane.origin = { column + 0.5, 0, 0 };
+					plane.normal = { 1, 0.02, 0 };
+					for (bool isClip : { false, true }) {
+						const auto expected(isClip ? mesh.Clip(plane) : mesh.Intersect(plane));
+						REQUIRE(expected.size() == 1);
+						for (const auto* cut : { &reversed, &reversedTopology }) {
+							if (isClip) {
+								cut->Clip(plane, workspace, result);
+							}
+							else {
+								cut->Intersect(plane, workspace, result);
+							}
+							REQUIRE(result.size() == 1);
+							REQUIRE(result[0].isClosed == expected[0].isClosed);
+							// the edges may be cut from the other end, so only match to rounding
+							REQUIRE(result[0].points.size() == expected[0].points.size());
+							for (size_t i(0); i < result[0].points.size(); ++i) {
+								for (int j(0); j < 3; ++j) {
+									REQUIRE(result[0].points[i][j] ==
+										Approx(expected[0].points[i][j]).margin(1e-12));
+								}
+							}
+#ifdef MESH_PLANE_INTERSECT_STATISTICS
+							REQUIRE(workspace.GetStatistics().edgePaths > rows);
+#endif
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("Clipping free edges that branch, with and without the cached free edges") {
+
+	GIVEN("two wavy grid sheets sharing one corner, where four free edges meet") {
+		std::vector<Intersector::Vec3D> vertices, sheet;
+		std::vector<Intersector::Face> faces, sheetFaces;
+		WavyGrid(30, 20, vertices, faces);
+		WavyGrid(30, 20, sheet, sheetFaces);
+		const int corner(static_cast<int>(vertices.size()) - 1);
+		const Intersector::Vec3D junction(vertices[corner]);
+		// the second sheet's first vertex is the first sheet's last
+		const int offset(static_cast<int>(vertices.size()) - 1);
+		for (size_t i(1); i < sheet.size(); ++i) {
+			vertices.push_back({ sheet[i][0] + junction[0], sheet[i][1] + junction[1],
+				sheet[i][2] + junction[2] });
+		}
+		for (const auto& face : sheetFaces) {
+			Intersector::Face shifted;
+			for (int i(0); i < 3; ++i) {
+				shifted[i] = face[i] == 0 ? corner : face[i] + offset;
+			}
+			faces.push_back(shifted);
+		}
+		Intersector::Mesh mesh(vertices, faces);
+		Intersector::Mesh withTopology(vertices, faces);
+		withTopology.BuildTopology();
+
+		WHEN("we clip them a few times with planes below the shared corner") {
+			THEN("the paths go through the corner and are the same every way") {
+				Intersector::Mesh::Workspace workspace, topologyWorkspace;
+				std::vector<Intersector::Path3D> result, topologyResult;
+				Intersector::Mesh::Section section(mesh, { 0.01,0.02,1 });
+				for (int i(0); i < 3; ++i) {
+					Intersector::Plane plane;
+					plane.normal = { 0.01,0.02,1 };
+					for (int j(0); j < 3; ++j) {
+						plane.origin[j] = junction[j] - plane.normal[j] * (0.05 + 0.2 * i);
+					}
+					const auto expected(mesh.Clip(plane));
+					mesh.Clip(plane, workspace, result);
+					withTopology.Clip(plane, topologyWorkspace, topologyResult);
+					const auto sectionResult(section.Clip(plane.origin[0] * plane.normal[0] +
+						plane.origin[1] * plane.normal[1] + plane.origin[2] * plane.normal[2]));
+
+					size_t junctionCount(0);
+					for (const auto& path : expected) {
+						junctionCount += std::count(path.points.begin(), path.points.end(), junction);
+					}
+					REQUIRE(junctionCount > 0);
+					for (const auto* paths : { &result, &topologyResult }) {
+						REQUIRE(paths->size() == expected.size());
+						for (size_t iPath(0); iPath < expected.size(); ++iPath) {
+							REQUIRE((*paths)[iPath].points == expected[iPath].points);
+							REQUIRE((*paths)[iPath].isClosed == expected[iPath].isClosed);
+						}
+					}
+					// the section's plane goes through normal * offset, so only the layout is
+					// the same to the last bit
+					REQUIRE(sectionResult.size() == expected.size());
+					for (size_t iPath(0); iPath < expected.size(); ++iPath) {
+						REQUIRE(sectionResult[iPath].points.size() == expected[iPath].points.size());
+						REQUIRE(sectionResult[iPath].isClosed == expected[iPath].isClosed);
+					}
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("Vertex arrays give the same offsets and signs as the vertices") {
+
+	GIVEN("a wavy grid mesh whose vertex count isn't a multiple of the lane or word width") {
+		std::vector<Intersector::Vec3D> vertices;
+		std::vector<Intersector::Face> faces;
+		WavyGrid(61, 37, vertices, faces);
+		REQUIRE(vertices.size() % 64 % 8 != 0);
+		Intersector::Mesh mesh(vertices, faces);
+		Intersector::Mesh arrays(vertices, faces);
+		arrays.BuildVertexArrays();
+
+		WHEN("we intersect and clip both with general and axis planes") {
+			std::vector<Intersector::Plane> planes(3);
+			planes[0].origin = { 0,0,0.1 };
+			planes[0].normal = { 0.01,0.02,1 };
+			// through the vertices of the first column, which are all at z = 0
+			planes[1].origin = { 0,0,0 };
+			planes[2].origin = { 30.5,0,0 };
+			planes[2].normal = { 1,0.25,0 };
+			Intersector::AxisPlane<0, -1> axisPlane;
+			axisPlane.position = 17;
+
+			THEN("the offsets, sign words and paths are all the same") {
+				Intersector::Mesh::Workspace workspace, arrayWorkspace;
+				std::vector<Intersector::Path3D> result, arrayResult;
+				const auto requireSame = [&]() {
+					REQUIRE(arrayWorkspace.GetVertexOffsets() == workspace.GetVertexOffsets());
+					REQUIRE(arrayWorkspace.GetPositiveSigns() == workspace.GetPositiveSigns());
+					REQUIRE(arrayWorkspace.GetNegativeSigns() == workspace.GetNegativeSigns());
+					REQUIRE(workspace.GetVertexOffsets().size() == vertices.size());
+					REQUIRE(arrayResult.size() == result.size());
+					for (size_t i(0); i < result.size(); ++i) {
+						REQUIRE(arrayResult[i].points == result[i].points);
+						REQUIRE(arrayResult[i].isClosed == result[i].isClosed);
+					}
+				};
+				for (const size_t threadCount : { 1, 3 }) {
+					for (const auto& plane : planes) {
+						mesh.Intersect(plane, workspace, result, threadCount);
+						arrays.Intersect(plane, arrayWorkspace, arrayResult, threadCount);
+						REQUIRE(!result.empty());
+						requireSame();
+						mesh.Clip(plane, workspace, result, threadCount);
+						arrays.Clip(plane, arrayWorkspace, arrayResult, threadCount);
+						requireSame();
+					}
+					mesh.Intersect(axisPlane, workspace, result, threadCount);
+					arrays.Intersect(axisPlane, arrayWorkspace, arrayResult, threadCount);
+					REQUIRE(!result.empty());
+					requireSame();
+					mesh.Clip(axisPlane, workspace, result, threadCount);
+					arrays.Clip(axisPlane, arrayWorkspace, arrayResult, threadCount);
+					requireSame();
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("Intersecting on several threads gives the same result") {
+
+	GIVEN("a wavy grid mesh") {
+		std::vector<Intersector::Vec3D> vertices;
+		std::vector<Intersector::Face> faces;
+		WavyGrid(200, 150, vertices, faces);
+
+		Intersector::Mesh mesh(vertices, faces);
+		Intersector::Plane plane;
+		plane.origin = { 0,0,0.1 };
+		plane.normal = { 0.01,0.02,1 };
+
+		WHEN("we intersect and clip the mesh on four threads") {
+			for (bool isClip : { false, true }) {
+				auto expected = isClip ? mesh.Clip(plane) : mesh.Intersect(plane);
+				auto result = isClip ? mesh.Clip(plane, 4) : mesh.Intersect(plane, 4);
+				REQUIRE(result.size() > 1);
+				REQUIRE(result.size() == expected.size());
+				for (size_t i(0); i < result.size(); ++i) {
+					REQUIRE(result[i].points == expected[i].points);
+					REQUIRE(result[i].isClosed == expected[i].isClosed);
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("Cutting with many planes at once gives the same result as one at a time") {
+
+	GIVEN("a wavy grid mesh and radial planes around a vertical axis through it") {
+		std::vector<Intersector::Vec3D> vertices;
+		std::vector<Intersector::Face> faces;
+		WavyGrid(80, 60, vertices, faces);
+
+		Intersector::Mesh mesh(vertices, faces);
+		std::vector<Intersector::Plane> planes(37);
+		for (size_t i(0); i < planes.size(); ++i) {
+			const double angle(0.1 * i + 0.01);
+			planes[i].origin = { 40.3, 30.2, 0 };
+			planes[i].normal = { std::cos(angle), std::sin(angle), 0.05 };
+		}
+
+		WHEN("we intersect and clip the mesh with all of them on one and four threads") {
+			for (size_t threadCount : { 1, 4 }) {
+				for (bool isClip : { false, true }) {
+					auto results = isClip ? mesh.ClipPlanes(planes, threadCount) :
+						mesh.IntersectPlanes(planes, threadCount);
+					REQUIRE(results.size() == planes.size());
+					for (size_t iPlane(0); iPlane < planes.size(); ++iPlane) {
+						auto expected = isClip ? mesh.Clip(planes[iPlane]) : mesh.Intersect(planes[iPlane]);
+						const auto& result(results[iPlane]);
+						REQUIRE(!result.empty());
+						REQUIRE(result.size() == expected.size());
+						for (size_t i(0); i < result.size(); ++i) {
+							REQUIRE(result[i].points == expected[i].points);
+							REQUIRE(result[i].isClosed == expected[i].isClosed);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("Axis planes cut the same as the matching general planes") {
+
+	GIVEN("a wavy grid mesh, with and without vertex arrays and a face hierarchy") {
+		std::vector<Intersector::Vec3D> vertices;
+		std::vector<Intersector::Face> faces;
+		WavyGrid(80, 60, vertices, faces);
+
+		Intersector::Mesh mesh(vertices, faces);
+		Intersector::Mesh arrayMesh(vertices, faces);
+		arrayMesh.BuildVertexArrays();
+		Intersector::Mesh hierarchyMesh(vertices, faces);
+		hierarchyMesh.BuildFaceHierarchy();
+		Intersector::AxisPlane<0> xPlane;
+		xPlane.position = 10.37;
+		Intersector::AxisPlane<2, -1> zPlane;
+		zPlane.position = 0.1;
+
+		WHEN("we intersect and clip with an x plane and a downward z plane") {
+			const auto check = [](const std::vector<Intersector::Path3D>& result,
+				const std::vector<Intersector::Path3D>& expected, const int axis) {
+				REQUIRE(!result.empty());
+				REQUIRE(result.size() == expected.size());
+				for (size_t i(0); i < result.size(); ++i) {
+					REQUIRE(result[i].isClosed == expected[i].isClosed);
+					REQUIRE(result[i].points.size() == expected[i].points.size());
+					for (size_t iPoint(0); iPoint < result[i].points.size(); ++iPoint) {
+						for (int j(0); j < 3; ++j) {
+							if (j != axis) {
+								REQUIRE(result[i].points[iPoint][j] == expected[i].points[iPoint][j]);
+							}
+						}
+					}
+				}
+			};
+
+			THEN("the paths match, and the intersection points lie exactly on the plane") {
+				for (const auto* testMesh : { &mesh, &arrayMesh, &hierarchyMesh }) {
+					const auto xPaths(testMesh->Intersect(xPlane));
+					check(xPaths, mesh.Intersect(xPlane.ToPlane()), 0);
+					for (const auto& path : xPaths) {
+						for (const auto& point : path.points) {
+							REQUIRE(point[0] == xPlane.position);
+						}
+					}
+					check(testMesh->Intersect(zPlane), mesh.Intersect(zPlane.ToPlane()), 2);
+					check(testMesh->Clip(zPlane), mesh.Clip(zPlane.ToPlane()), 2);
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("Vertices on the plane give closed contours") {
+
+	GIVEN("an octahedron with four of its vertices on the plane z = 0") {
+		std::vector<Intersector::Vec3D> vertices{
+			{1,0,0}, {0,1,0}, {-1,0,0}, {0,-1,0}, {0,0,1}, {0,0,-1}
+		};
+		std::vector<Intersector::Face> faces{
+			{0,1,4}, {1,2,4}, {2,3,4}, {3,0,4},
+			{1,0,5}, {2,1,5}, {3,2,5}, {0,3,5}
+		};
+		Intersector::Mesh mesh(vertices, faces);
+
+		WHEN("we intersect it with the plane either way up") {
+			for (const double direction : { 1.0, -1.0 }) {
+				Intersector::Plane plane;
+				plane.normal = { 0, 0, direction };
+				auto result = mesh.Intersect(plane);
+				THEN("there is one closed path through the four vertices") {
+					REQUIRE(result.size() == 1);
+					REQUIRE(result[0].isClosed);
+					REQUIRE(result[0].points.size() == 4);
+					for (const auto& point : result[0].points) {
+						REQUIRE(std::find(vertices.begin(), vertices.begin() + 4, point) !=
+							vertices.begin() + 4);
+					}
+				}
+			}
+		}
+
+		WHEN("the plane only touches the top vertex") {
+			Intersector::Plane plane;
+			plane.origin = { 0, 0, 1 };
+			THEN("there are no paths") {
+				REQUIRE(mesh.Intersect(plane).empty());
+			}
+		}
+	}
+
+	GIVEN("a closed cube with a grid of vertices on its sides") {
+		std::vector<Intersector::Vec3D> vertices;
+		std::vector<Intersector::Face> faces;
+		GridCube(6, vertices, faces);
+		Intersector::Mesh mesh(vertices, faces);
+		Intersector::Mesh arrayMesh(vertices, faces);
+		arrayMesh.BuildVertexArrays();
+		Intersector::Mesh hierarchyMesh(vertices, faces);
+		hierarchyMesh.BuildFaceHierarchy();
+
+		WHEN("we intersect it with planes through rows and diagonals of the vertices") {
+			std::vector<Intersector::Plane> planes(4);
+			planes[0].origin = { 0, 0, 2 };
+			planes[1].normal = { 1, 1, 1 };
+			planes[1].origin = { 2, 2, 2 };
+			planes[2].normal = { 0.1, 0.2, 0.3 };
+			planes[2].origin = { 0, 3, 4 };
+			planes[3].normal = { 0.3, -0.1, 0.7 };
+			planes[3].origin = { 6, 1, 3 };
+			THEN("every contour is closed, with the same result with and without the vertex arrays and hierarchy") {
+				for (const auto& plane : planes) {
+					const auto result(mesh.Intersect(plane));
+					REQUIRE(!result.empty());
+					for (const auto& path : result) {
+						REQUIRE(path.isClosed);
+						REQUIRE(path.points.size() >= 3);
+					}
+					for (const auto* otherMesh : { &arrayMesh, &hierarchyMesh }) {
+						const auto other(otherMesh->Intersect(plane));
+						REQUIRE(other.size() == result.size());
+						for (size_t i(0); i < result.size(); ++i) {
+							REQUIRE(other[i].points == result[i].points);
+						}
+					}
+				}
+				Intersector::AxisPlane<2> axisPlane;
+				axisPlane.position = 2;
+				const auto axisResult(mesh.Intersect(axisPlane));
+				REQUIRE(axisResult.size() == 1);
+				REQUIRE(axisResult[0].isClosed);
+				REQUIRE(axisResult[0].points == mesh.Intersect(planes[0])[0].points);
+			}
+		}
+	}
+}
+
+SCENARIO("Vertices just off the plane aren't taken to be on it") {
+
+	GIVEN("a triangle with a corner the smallest normal number above the plane x = 0") {
+		const double smallest(std::numeric_limits<double>::min());
+		std::vector<Intersector::Vec3D> vertices{ { smallest,0,0 }, { -1,1,0 }, { -1,-1,0 } };
+		// unused vertices, so that there is a whole word of them for the SIMD kernels
+		for (int i(0); i < 64; ++i) {
+			vertices.push_back({ -2.0, double(i), 0 });
+		}
+		std::vector<Intersector::Face> faces{ { 0,1,2 } };
+		Intersector::Mesh mesh(vertices, faces);
+		Intersector::Mesh arrays(vertices, faces);
+		arrays.BuildVertexArrays();
+
+		WHEN("we intersect it with general and axis planes") {
+			Intersector::AxisPlane<0> axisPlane;
+			const Intersector::Plane plane(axisPlane.ToPlane());
+			const std::vector<std::vector<Intersector::Path3D>> results{
+				mesh.Intersect(plane), arrays.Intersect(plane),
+				mesh.Intersect(axisPlane), arrays.Intersect(axisPlane) };
+
+			THEN("the path cuts the two edges beside the corner rather than passing through it") {
+				for (const auto& result : results) {
+					REQUIRE(result.size() == 1);
+					REQUIRE(!result[0].isClosed);
+					REQUIRE(result[0].points.size() == 2);
+					for (const auto& point : result[0].points) {
+						REQUIRE(point != vertices[0]);
+						REQUIRE(point[1] != 0);
+					}
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("A face hierarchy gives the same intersections") {
+
+	GIVEN("a wavy grid mesh with a face hierarchy") {
+		std::vector<Intersector::Vec3D> vertices;
+		std::vector<Intersector::Face> faces;
+		WavyGrid(120, 80, vertices, faces);
+
+		Intersector::Mesh mesh(vertices, faces);
+		Intersector::Mesh hierarchyMesh(vertices, faces);
+		hierarchyMesh.BuildFaceHierarchy();
+
+		WHEN("the plane cuts across the whole mesh or grazes one corner") {
+			Intersector::Plane across, corner;
+			across.origin = { 0,0,0.2 };
+			corner.origin = { 2,2,0 };
+			corner.normal = { -1,-1,0 };
+			for (const auto& plane : { across, corner }) {
+				for (bool isClip : { false, true }) {
+					auto expected = isClip ? mesh.Clip(plane) : mesh.Intersect(plane);
+					auto result = isClip ? hierarchyMesh.Clip(plane) : hierarchyMesh.Intersect(plane);
+					REQUIRE(result.size() == expected.size());
+					for (size_t i(0); i < result.size(); ++i) {
+						REQUIRE(result[i].points == expected[i].points);
+						REQUIRE(result[i].isClosed == expected[i].isClosed);
+					}
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("Reusing a workspace gives the same intersections") {
+
+	GIVEN("a wavy grid mesh and a workspace") {
+		std::vector<Intersector::Vec3D> vertices;
+		std::vector<Intersector::Face> faces;
+		WavyGrid(60, 40, vertices, faces);
+
+		Intersector::Mesh mesh(vertices, faces);
+		Intersector::Mesh::Workspace workspace;
+		std::vector<Intersector::Path3D> result;
+
+		WHEN("we intersect and clip the mesh with a plane moving up through it") {
+			Intersector::Plane plane;
+			plane.normal = { 0.01,0.02,1 };
+			for (int step(0); step < 10; ++step) {
+				plane.origin = { 0,0,-0.5 + 0.1 * step };
+				for (bool isClip : { false, true }) {
+					auto expected = isClip ? mesh.Clip(plane) : mesh.Intersect(plane);
+					if (isClip) {
+						mesh.Clip(plane, workspace, result);
+					}
+					else {
+						mesh.Intersect(plane, workspace, result);
+					}
+					REQUIRE(result.size() == expected.size());
+					for (size_t i(0); i < result.size(); ++i) {
+						REQUIRE(result[i].points == expected[i].points);
+						REQUIRE(result[i].isClosed == expected[i].isClosed);
+					}
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("Statistics are recorded when they are compiled in") {
+
+	GIVEN("a wavy grid mesh and a workspace with a statistics hook") {
+		std::vector<Intersector::Vec3D> vertices;
+		std::vector<Intersector::Face> faces;
+		WavyGrid(60, 40, vertices, faces);
+
+		Intersector::Mesh mesh(vertices, faces);
+		Intersector::Mesh::Workspace workspace;
+		int hookCalls(0);
+		workspace.SetStatisticsHook([&hookCalls](const Intersector::Statistics&) { ++hookCalls; });
+		std::vector<Intersector::Path3D> result;
+		Intersector::Plane plane;
+		plane.normal = { 0.01,0.02,1 };
+
+		WHEN("we clip the mesh") {
+			mesh.Clip(plane, workspace, result);
+			const auto& statistics(workspace.GetStatistics());
+#ifdef MESH_PLANE_INTERSECT_STATISTICS
+			REQUIRE(hookCalls == 1);
+			REQUIRE(statistics.crossingFaces > 0);
+			REQUIRE(statistics.edgePaths > 0);
+			REQUIRE(statistics.freeEdgePaths > 0);
+			REQUIRE(statistics.chainedPaths == result.size());
+			REQUIRE(statistics.chainProbes >= 2 * (statistics.edgePaths + statistics.freeEdgePaths));
+			REQUIRE(statistics.freeEdges == 2 * (60 - 1 + 40 - 1));
+			REQUIRE(statistics.workspaceBytes > 0);
+			REQUIRE(statistics.workspaceGrowthBytes == statistics.workspaceBytes);
+
+			mesh.Clip(plane, workspace, result);
+			REQUIRE(hookCalls == 2);
+			REQUIRE(statistics.chainedPaths == result.size());
+			REQUIRE(statistics.workspaceGrowthBytes == 0);
+#else
+			REQUIRE(hookCalls == 0);
+			REQUIRE(statistics.crossingFaces == 0);
+			REQUIRE(statistics.workspaceBytes == 0);
+#endif
+		}
+	}
+}
+
+SCENARIO("Flat and streamed results hold the same paths") {
+
+	GIVEN("a wavy grid mesh and a workspace") {
+		std::vector<Intersector::Vec3D> vertices;
+		std::vector<Intersector::Face> faces;
+		WavyGrid(60, 40, vertices, faces);
+
+		Intersector::Mesh mesh(vertices, faces);
+		Intersector::Mesh::Workspace workspace;
+		Intersector::Plane plane;
+		plane.origin = { 0,0,0.1 };
+		plane.normal = { 0.01,0.02,1 };
+
+		WHEN("we intersect and clip the mesh into a flat buffer and a sink") {
+			for (bool isClip : { false, true }) {
+				auto expected = isClip ? mesh.Clip(plane) : mesh.Intersect(plane);
+				Intersector::FlatPaths flat;
+				std::vector<Intersector::Path3D> streamed;
+				const auto sink = [&streamed](const Intersector::Vec3D* points, size_t count,
+					bool isClosed) {
+					streamed.push_back({ { points, points + count }, isClosed });
+				};
+				if (isClip) {
+					mesh.Clip(plane, workspace, flat, 2);
+					mesh.Clip(plane, workspace, sink);
+				}
+				else {
+					mesh.Intersect(plane, workspace, flat, 2);
+					mesh.Intersect(plane, workspace, sink);
+				}
+				REQUIRE(expected.size() > 1);
+				REQUIRE(flat.starts.size() == expected.size() + 1);
+				REQUIRE(streamed.size() == expected.size());
+				for (size_t i(0); i < expected.size(); ++i) {
+					REQUIRE(std::vector<Intersector::Vec3D>(flat.points.begin() + flat.starts[i],
+						flat.points.begin() + flat.starts[i + 1]) == expected[i].points);
+					REQUIRE(flat.isClosed[i] == expected[i].isClosed);
+					REQUIRE(streamed[i].points == expected[i].points);
+					REQUIRE(streamed[i].isClosed == expected[i].isClosed);
+				}
+			}
+		}
+	}
+}
+
+// the distance from point to the nearest segment of path
+static double PathDistance(const Intersector::Vec3D& point, const Intersector::Path3D& path) {
+	double nearest(1e300);
+	const size_t sideCount(path.points.size() - (path.isClosed ? 0 : 1));
+	for (size_t iSide(0); iSide < sideCount; ++iSide) {
+		const auto& a(path.points[iSide]);
+		const auto& b(path.points[(iSide + 1) % path.points.size()]);
+		double along(0), squaredLength(0);
+		for (int i(0); i < 3; ++i) {
+			along += (point[i] - a[i]) * (b[i] - a[i]);
+			squaredLength += (b[i] - a[i]) * (b[i] - a[i]);
+		}
+		const double factor(squaredLength > 0 ? std::min(1.0, std::max(0.0, along / squaredLength)) : 0);
+		double squaredDistance(0);
+		for (int i(0); i < 3; ++i) {
+			const double difference(point[i] - a[i] - (b[i] - a[i]) * factor);
+			squaredDistance += difference * difference;
+		}
+		nearest = std::min(nearest, std::sqrt(squaredDistance));
+	}
+	return nearest;
+}
+
+SCENARIO("Paths simplified within a tolerance") {
+
+	GIVEN("a wavy grid mesh") {
+		std::vector<Intersector::Vec3D> vertices;
+		std::vector<Intersector::Face> faces;
+		WavyGrid(60, 40, vertices, faces);
+		Intersector::Mesh mesh(vertices, faces);
+		Intersector::Plane plane;
+		plane.origin = { 0,0,0.1 };
+		plane.normal = { 0.01,0.02,1 };
+
+		WHEN("we intersect and clip it with and without a tolerance") {
+			for (bool isClip : { false, true }) {
+				const auto full(isClip ? mesh.Clip(plane) : mesh.Intersect(plane));
+				const auto simplified(isClip ? mesh.Clip(plane, 2, 0.05) : mesh.Intersect(plane, 2, 0.05));
+				const auto exact(isClip ? mesh.Clip(plane, 1, 0) : mesh.Intersect(plane, 1, 0));
+
+				THEN("the paths keep their ends and stay within the tolerance") {
+					REQUIRE(exact.size() == full.size());
+					REQUIRE(simplified.size() == full.size());
+					size_t fullCount(0), simplifiedCount(0);
+					for (size_t i(0); i < full.size(); ++i) {
+						REQUIRE(exact[i].points == full[i].points);
+						REQUIRE(simplified[i].isClosed == full[i].isClosed);
+						REQUIRE(simplified[i].points.front() == full[i].points.front());
+						if (!full[i].isClosed) {
+							REQUIRE(simplified[i].points.back() == full[i].points.back());
+						}
+						for (const auto& point : full[i].points) {
+							REQUIRE(PathDistance(point, simplified[i]) <= 0.05 + 1e-12);
+						}
+						fullCount += full[i].points.size();
+						simplifiedCount += simplified[i].points.size();
+					}
+					REQUIRE(simplifiedCount * 2 < fullCount);
+				}
+			}
+		}
+
+		WHEN("we stream the paths to a sink with a tolerance") {
+			Intersector::Mesh::Workspace workspace;
+
+			THEN("they are simplified the same as the returned paths") {
+				for (bool isClip : { false, true }) {
+					const auto simplified(isClip ? mesh.Clip(plane, 1, 0.05) : mesh.Intersect(plane, 1, 0.05));
+					std::vector<Intersector::Path3D> streamed;
+					const auto sink = [&streamed](const Intersector::Vec3D* points, size_t count,
+						bool isClosed) {
+						streamed.push_back({ { points, points + count }, isClosed });
+					};
+					if (isClip) {
+						mesh.Clip(plane, workspace, sink, 2, 0.05);
+					}
+					else {
+						mesh.Intersect(plane, workspace, sink, 2, 0.05);
+					}
+					REQUIRE(streamed.size() == simplified.size());
+					for (size_t i(0); i < simplified.size(); ++i) {
+						REQUIRE(streamed[i].isClosed == simplified[i].isClosed);
+						REQUIRE(streamed[i].points == simplified[i].points);
+					}
+				}
+			}
+		}
+	}
+
+	GIVEN("a cube with a fine grid on each side") {
+		std::vector<Intersector::Vec3D> vertices;
+		std::vector<Intersector::Face> faces;
+		GridCube(20, vertices, faces);
+		Intersector::Mesh mesh(vertices, faces);
+
+		WHEN("we cut it across with a small tolerance") {
+			Intersector::AxisPlane<2> plane;
+			plane.position = 7.5;
+			const auto full(mesh.Intersect(plane));
+			const auto simplified(mesh.Intersect(plane, 1, 1e-9));
+
+			THEN("only the corners are left, and the first point") {
+				REQUIRE(full.size() == 1);
+				REQUIRE(full[0].points.size() == 160);
+				REQUIRE(simplified.size() == 1);
+				REQUIRE(simplified[0].isClosed);
+				REQUIRE(simplified[0].points.size() <= 5);
+				REQUIRE(simplified[0].points.size() >= 4);
+				for (const auto& point : full[0].points) {
+					REQUIRE(PathDistance(point, simplified[0]) <= 1e-9);
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("Symbolic paths interpolate to the same points") {
+
+	GIVEN("a wavy grid mesh with a value at each vertex") {
+		std::vector<Intersector::Vec3D> vertices;
+		std::vector<Intersector::Face> faces;
+		WavyGrid(60, 40, vertices, faces);
+		std::vector<double> temperatures;
+		for (const auto& vertex : vertices) {
+			temperatures.push_back(vertex[0] + 2 * vertex[1]);
+		}
+
+		Intersector::Mesh mesh(vertices, faces);
+		Intersector::Mesh::Workspace workspace;
+		Intersector::Plane plane;
+		plane.origin = { 0,0,0.1 };
+		plane.normal = { 0.01,0.02,1 };
+
+		WHEN("we intersect and clip the mesh into symbolic paths and interpolate") {
+			for (bool isClip : { false, true }) {
+				Intersector::FlatPaths flat;
+				Intersector::SymbolicPaths symbolic;
+				if (isClip) {
+					mesh.Clip(plane, workspace, flat);
+					mesh.Clip(plane, workspace, symbolic, 2);
+				}
+				else {
+					mesh.Intersect(plane, workspace, flat);
+					mesh.Intersect(plane, workspace, symbolic, 2);
+				}
+				std::vector<Intersector::Vec3D> points(symbolic.points.size());
+				std::vector<double> pointTemperatures(symbolic.points.size());
+				Intersector::Mesh::Interpolate(symbolic, {
+					{ vertices.front().data(), 3, points.front().data() },
+					{ temperatures.data(), 1, pointTemperatures.data() } }, 2);
+
+				THEN("the layout and positions match the flat paths") {
+					REQUIRE(symbolic.starts == flat.starts);
+					REQUIRE(symbolic.isClosed == flat.isClosed);
+					REQUIRE(points == flat.points);
+				}
+				THEN("the values are interpolated along the edges") {
+					for (size_t i(0); i < points.size(); ++i) {
+						REQUIRE(pointTemperatures[i] == Approx(points[i][0] + 2 * points[i][1]));
+					}
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("Section properties are added up while tracing") {
+
+	GIVEN("a hollow cube, 6 wide outside and 2 wide inside") {
+		std::vector<Intersector::Vec3D> vertices;
+		std::vector<Intersector::Face> faces;
+		GridCube(6, vertices, faces);
+		std::vector<Intersector::Vec3D> innerVertices;
+		std::vector<Intersector::Face> innerFaces;
+		GridCube(2, innerVertices, innerFaces);
+		// the inner faces are turned inside out and moved to the middle
+		const int firstInner(static_cast<int>(vertices.size()));
+		for (const auto& vertex : innerVertices) {
+			vertices.push_back({ vertex[0] + 2, vertex[1] + 2, vertex[2] + 2 });
+		}
+		for (const auto& face : innerFaces) {
+			faces.push_back({ face[0] + firstInner, face[2] + firstInner, face[1] + firstInner });
+		}
+		Intersector::Mesh mesh(vertices, faces);
+		Intersector::Mesh::Workspace workspace;
+
+		WHEN("we cut it through the hole") {
+			Intersector::Plane plane;
+			plane.origin = { 0, 0, 2.5 };
+			std::vector<Intersector::AreaProperties> loops;
+			Intersector::AreaProperties total;
+			mesh.IntersectProperties(plane, workspace, loops, total);
+
+			THEN("the outside is positive and the hole negative") {
+				REQUIRE(loops.size() == 2);
+				REQUIRE(loops[0].area == Approx(36));
+				REQUIRE(loops[0].perimeter == Approx(24));
+				REQUIRE(loops[1].area == Approx(-4));
+				REQUIRE(loops[1].perimeter == Approx(8));
+			}
+			THEN("the total is the area between them, about the middle") {
+				REQUIRE(total.area == Approx(32));
+				REQUIRE(total.perimeter == Approx(32));
+				REQUIRE(total.centroid[0] == Approx(3));
+				REQUIRE(total.centroid[1] == Approx(3));
+				REQUIRE(total.centroid[2] == Approx(2.5));
+				// 6^4 / 12 less 2^4 / 12
+				REQUIRE(total.secondMoments[0] == Approx(1280.0 / 12));
+				REQUIRE(total.secondMoments[1] == Approx(1280.0 / 12));
+				REQUIRE(total.secondMoments[2] == Approx(0).margin(1e-9));
+				REQUIRE(mesh.IntersectProperties(plane).area == Approx(32));
+			}
+		}
+
+		WHEN("we cut it with a plane facing down off centre") {
+			Intersector::Plane plane;
+			plane.origin = { 1, 2, 0.5 };
+			plane.normal = { 0, 0, -1 };
+			const auto total(mesh.IntersectProperties(plane));
+			THEN("the properties are those of the solid square") {
+				REQUIRE(total.area == Approx(36));
+				REQUIRE(total.centroid[0] == Approx(3));
+				REQUIRE(total.centroid[1] == Approx(3));
+				REQUIRE(total.centroid[2] == Approx(0.5));
+				REQUIRE(total.secondMoments[0] == Approx(108));
+				REQUIRE(total.secondMoments[1] == Approx(108));
+			}
+		}
+	}
+}
+
+SCENARIO("Reordered meshes and 64 bit indices give the same sections") {
+
+	GIVEN("a grid cube and a wavy grid") {
+		std::vector<Intersector::Vec3D> cubeVertices, gridVertices;
+		std::vector<Intersector::Face> cubeFaces, gridFaces;
+		GridCube(6, cubeVertices, cubeFaces);
+		WavyGrid(60, 40, gridVertices, gridFaces);
+		Intersector::Plane plane;
+		plane.origin = { 2.3, 2.6, 0.1 };
+		plane.normal = { 0.2, 0.3, 1 };
+
+		WHEN("we reorder them along a Morton curve") {
+			auto vertices(cubeVertices);
+			auto faces(cubeFaces);
+			std::vector<int> vertexOrder, faceOrder;
+			Intersector::Mesh::Reorder(vertices, faces, vertexOrder, faceOrder, 2);
+
+			THEN("the tables lead back to the old vertices and faces") {
+				REQUIRE(vertexOrder.size() == vertices.size());
+				REQUIRE(faceOrder.size() == faces.size());
+				for (size_t i(0); i < vertices.size(); ++i) {
+					REQUIRE(vertices[i] == cubeVertices[vertexOrder[i]]);
+				}
+				for (size_t i(0); i < faces.size(); ++i) {
+					for (int j(0); j < 3; ++j) {
+						REQUIRE(vertexOrder[faces[i][j]] == cubeFaces[faceOrder[i]][j]);
+					}
+				}
+			}
+			THEN("the section is the same") {
+				Intersector::Mesh original(cubeVertices, cubeFaces);
+				Intersector::Mesh reordered(vertices, faces);
+				reordered.BuildTopology();
+				const auto expected(original.IntersectProperties(plane));
+				const auto actual(reordered.IntersectProperties(plane));
+				REQUIRE(actual.area == Approx(expected.area));
+				REQUIRE(actual.perimeter == Approx(expected.perimeter));
+				for (int i(0); i < 3; ++i) {
+					REQUIRE(actual.centroid[i] == Approx(expected.centroid[i]));
+				}
+				REQUIRE(reordered.Clip(plane).size() == original.Clip(plane).size());
+			}
+		}
+
+		WHEN("we use 64 bit indices") {
+			typedef MeshPlaneIntersect<double, std::int64_t> WideIntersector;
+			std::vector<WideIntersector::Face> wideFaces;
+			for (const auto& face : gridFaces) {
+				wideFaces.push_back({ face[0], face[1], face[2] });
+			}
+			Intersector::Mesh mesh(gridVertices, gridFaces);
+			WideIntersector::Mesh wideMesh(gridVertices, wideFaces);
+			wideMesh.BuildTopology();
+			WideIntersector::Plane widePlane;
+			widePlane.origin = plane.origin;
+			widePlane.normal = plane.normal;
+
+			THEN("the paths are the same") {
+				for (const bool clip : { false, true }) {
+					const auto expected(clip ? mesh.Clip(plane) : mesh.Intersect(plane));
+					const auto actual(clip ? wideMesh.Clip(widePlane, 2) : wideMesh.Intersect(widePlane, 2));
+					REQUIRE(actual.size() == expected.size());
+					for (size_t i(0); i < actual.size(); ++i) {
+						REQUIRE(actual[i].isClosed == expected[i].isClosed);
+						REQUIRE(actual[i].points == expected[i].points);
+					}
+				}
+			}
+		}
+
+		WHEN("we use unsigned 32 bit indices") {
+			typedef MeshPlaneIntersect<double, std::uint32_t> UnsignedIntersector;
+			std::vector<UnsignedIntersector::Face> unsignedFaces;
+			for (const auto& face : gridFaces) {
+				unsignedFaces.push_back({ static_cast<std::uint32_t>(face[0]),
+					static_cast<std::uint32_t>(face[1]), static_cast<std::uint32_t>(face[2]) });
+			}
+			Intersector::Mesh mesh(gridVertices, gridFaces);
+			UnsignedIntersector::Mesh unsignedMesh(gridVertices, unsignedFaces);
+			UnsignedIntersector::Mesh builtMesh(gridVertices, unsignedFaces);
+			builtMesh.BuildTopology();
+			builtMesh.BuildFaceHierarchy();
+			UnsignedIntersector::Plane unsignedPlane;
+			unsignedPlane.origin = plane.origin;
+			unsignedPlane.normal = plane.normal;
+
+			THEN("the paths are the same, with and without the topology") {
+				for (const bool clip : { false, true }) {
+					const auto expected(clip ? mesh.Clip(plane) : mesh.Intersect(plane));
+					for (const auto* unsignedCase : { &unsignedMesh, &builtMesh }) {
+						const auto actual(clip ? unsignedCase->Clip(unsignedPlane, 2) :
+							unsignedCase->Intersect(unsignedPlane, 2));
+						REQUIRE(actual.size() == expected.size());
+						for (size_t i(0); i < actual.size(); ++i) {
+							REQUIRE(actual[i].isClosed == expected[i].isClosed);
+							REQUIRE(actual[i].points == expected[i].points);
+						}
+					}
+				}
+			}
+			THEN("split parts number their vertices the same") {
+				const auto expected(mesh.Split(plane));
+				const auto actual(builtMesh.Split(unsignedPlane));
+				REQUIRE(actual.first.vertices == expected.first.vertices);
+				REQUIRE(actual.second.vertices == expected.second.vertices);
+				REQUIRE(actual.first.faces.size() == expected.first.faces.size());
+				for (size_t i(0); i < actual.first.faces.size(); ++i) {
+					for (int j(0); j < 3; ++j) {
+						REQUIRE(actual.first.faces[i][j] == static_cast<std::uint32_t>(expected.first.faces[i][j]));
+					}
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("Sections come out as nested polygons in the plane") {
+
+	GIVEN("a hollow cube with a smaller cube in its hole, next to a row of small cubes") {
+		std::vector<Intersector::Vec3D> vertices;
+		std::vector<Intersector::Face> faces;
+		// adds a cube of the given size, turned inside out for a hole
+		const auto addCube = [&](const int size, const Intersector::Vec3D& corner, const bool isHole) {
+			std::vector<Intersector::Vec3D> cubeVertices;
+			std::vector<Intersector::Face> cubeFaces;
+			GridCube(size, cubeVertices, cubeFaces);
+			const int first(static_cast<int>(vertices.size()));
+			for (const auto& vertex : cubeVertices) {
+				vertices.push_back({ vertex[0] + corner[0], vertex[1] + corner[1], vertex[2] + corner[2] });
+			}
+			for (const auto& face : cubeFaces) {
+				faces.push_back({ face[0] + first, face[isHole ? 2 : 1] + first, face[isHole ? 1 : 2] + first });
+			}
+		};
+		addCube(10, { 0,0,0 }, false);
+		addCube(6, { 2,2,2 }, true);
+		addCube(2, { 4,4,4 }, false);
+		for (int i(0); i < 50; ++i) {
+			addCube(1, { 11.0 + i * 2, 0, 4.5 }, false);
+		}
+		Intersector::Mesh mesh(vertices, faces);
+
+		WHEN("we cut through all of them") {
+			Intersector::Plane plane;
+			plane.origin = { 0, 0, 5 };
+			auto polygons = mesh.IntersectPolygons(plane);
+			Intersector::PlaneFrame frame(plane);
+			const auto signedArea = [](const Intersector::Polygon2D& polygon) {
+				double area(0);
+				for (size_t i(0); i < polygon.points.size(); ++i) {
+					const auto& a(polygon.points[i]);
+					const auto& b(polygon.points[(i + 1) % polygon.points.size()]);
+					area += (a[0] * b[1] - b[0] * a[1]) / 2;
+				}
+				return area;
+			};
+
+			THEN("the loops nest inside each other and turn the right way") {
+				REQUIRE(polygons.size() == 53);
+				int outlines(0);
+				for (size_t i(0); i < polygons.size(); ++i) {
+					const auto& polygon(polygons[i]);
+					const double area(signedArea(polygon));
+					if (std::abs(area) == Approx(100)) {
+						REQUIRE(polygon.parent == -1);
+						REQUIRE(polygon.depth == 0);
+						REQUIRE(polygon.children.size() == 1);
+						REQUIRE(area > 0);
+						const auto& hole(polygons[polygon.children[0]]);
+						REQUIRE(hole.parent == static_cast<int>(i));
+						REQUIRE(hole.depth == 1);
+						REQUIRE(signedArea(hole) == Approx(-36));
+						REQUIRE(hole.children.size() == 1);
+						const auto& island(polygons[hole.children[0]]);
+						REQUIRE(island.depth == 2);
+						REQUIRE(island.children.empty());
+						REQUIRE(signedArea(island) == Approx(4));
+					}
+					if (polygon.depth == 0) {
+						++outlines;
+						REQUIRE(area > 0);
+					}
+				}
+				REQUIRE(outlines == 51);
+			}
+			THEN("the points are those of the paths in the plane frame") {
+				const auto paths(mesh.Intersect(plane));
+				REQUIRE(paths.size() == polygons.size());
+				for (size_t i(0); i < paths.size(); ++i) {
+					for (const auto& point : paths[i].points) {
+						const auto coordinates(frame.Coordinates(point));
+						REQUIRE(std::find(polygons[i].points.begin(), polygons[i].points.end(),
+							coordinates) != polygons[i].points.end());
+					}
+				}
+			}
+		}
+	}
+}
+
+// the signed volume inside a closed mesh, positive when its faces are wound outwards
+static double Volume(const Intersector::IndexedMesh& mesh) {
+	double volume(0);
+	for (const auto& face : mesh.faces) {
+		const auto& a(mesh.vertices[face[0]]);
+		const auto& b(mesh.vertices[face[1]]);
+		const auto& c(mesh.vertices[face[2]]);
+		volume += (a[0] * (b[1] * c[2] - b[2] * c[1]) + a[1] * (b[2] * c[0] - b[0] * c[2]) +
+			a[2] * (b[0] * c[1] - b[1] * c[0])) / 6;
+	}
+	return volume;
+}
+
+// whether each edge of a face is used once the other way round by another face
+static bool IsClosed(const Intersector::IndexedMesh& mesh) {
+	std::map<std::pair<int, int>, int> edges;
+	for (const auto& face : mesh.faces) {
+		for (int i(0); i < 3; ++i) {
+			++edges[{ face[i], face[(i + 1) % 3] }];
+		}
+	}
+	for (const auto& edge : edges) {
+		const auto twin(edges.find({ edge.first.second, edge.first.first }));
+		if (edge.second != 1 || twin == edges.end() || twin->second != 1) {
+			return false;
+		}
+	}
+	return true;
+}
+
+SCENARIO("Splitting a mesh into capped parts") {
+
+	GIVEN("a hollow cube with a smaller cube in its hole, and a cube with two holes") {
+		std::vector<Intersector::Vec3D> vertices;
+		std::vector<Intersector::Face> faces;
+		// adds a cube of the given size, turned inside out for a hole
+		const auto addCube = [&](const int size, const Intersector::Vec3D& corner, const bool isHole) {
+			std::vector<Intersector::Vec3D> cubeVertices;
+			std::vector<Intersector::Face> cubeFaces;
+			GridCube(size, cubeVertices, cubeFaces);
+			const int first(static_cast<int>(vertices.size()));
+			for (const auto& vertex : cubeVertices) {
+				vertices.push_back({ vertex[0] + corner[0], vertex[1] + corner[1], vertex[2] + corner[2] });
+			}
+			for (const auto& face : cubeFaces) {
+				faces.push_back({ face[0] + first, face[isHole ? 2 : 1] + first, face[isHole ? 1 : 2] + first });
+			}
+		};
+		addCube(10, { 0,0,0 }, false);
+		addCube(6, { 2,2,2 }, true);
+		addCube(2, { 4,4,4 }, false);
+		addCube(4, { 12,0,0 }, false);
+		addCube(1, { 13,1,1 }, true);
+		addCube(1, { 14.5,1.5,1 }, true);
+		Intersector::Mesh mesh(vertices, faces);
+		const double volume(1000 - 216 + 8 + 64 - 1 - 1);
+
+		for (const auto& origin : std::vector<Intersector::Vec3D>{ { 5,5,5 }, { 0,0,1.5 }, { 0,0,2 } }) {
+			WHEN("we split it with the plane through " + std::to_string(origin[2])) {
+				Intersector::Plane plane;
+				plane.origin = origin;
+				if (origin[2] == 5) {
+					plane.normal = { 0.1, 0.2, 1 };
+				}
+				const auto parts(mesh.Split(plane));
+
+				THEN("both parts are closed and add up to the whole") {
+					REQUIRE(IsClosed(parts.first));
+					REQUIRE(IsClosed(parts.second));
+					REQUIRE(Volume(parts.first) > 0);
+					REQUIRE(Volume(parts.second) > 0);
+					REQUIRE(Volume(parts.first) + Volume(parts.second) == Approx(volume));
+					if (origin[2] == 1.5) {
+						REQUIRE(Volume(parts.second) == Approx(150 + 24 - 1));
+					}
+					if (origin[2] == 2) {
+						REQUIRE(Volume(parts.second) == Approx(200 + 32 - 2));
+					}
+				}
+				THEN("each part is on its own side of the plane") {
+					const auto side = [&plane](const Intersector::Vec3D& point) {
+						double offset(0);
+						for (int i(0); i < 3; ++i) {
+							offset += (point[i] - plane.origin[i]) * plane.normal[i];
+						}
+						return offset;
+					};
+					for (const auto& vertex : parts.first.vertices) {
+						REQUIRE(side(vertex) > -1e-12);
+					}
+					for (const auto& vertex : parts.second.vertices) {
+						REQUIRE(side(vertex) < 1e-12);
+					}
+				}
+				THEN("the parts can be intersected again") {
+					Intersector::Mesh above(parts.first.vertices, parts.first.faces);
+					Intersector::Plane higher(plane);
+					higher.origin[2] += 0.25;
+					REQUIRE(above.IntersectProperties(higher).area ==
+						Approx(mesh.IntersectProperties(higher).area));
+				}
+				THEN("splitting again with one workspace gives the same parts") {
+					Intersector::Mesh::Workspace workspace;
+					Intersector::IndexedMesh above, below;
+					for (int i(0); i < 2; ++i) {
+						mesh.Split(plane, workspace, above, below, true);
+						REQUIRE(above.vertices == parts.first.vertices);
+						REQUIRE(above.faces == parts.first.faces);
+						REQUIRE(below.vertices == parts.second.vertices);
+						REQUIRE(below.faces == parts.second.faces);
+					}
+				}
+			}
+		}
+	}
+
+	GIVEN("an open wavy grid") {
+		std::vector<Intersector::Vec3D> vertices;
+		std::vector<Intersector::Face> faces;
+		WavyGrid(60, 40, vertices, faces);
+		Intersector::Mesh mesh(vertices, faces);
+
+		WHEN("we split it without caps") {
+			Intersector::Plane plane;
+			plane.origin = { 0, 0, 0.1 };
+			Intersector::Mesh::Workspace workspace;
+			Intersector::IndexedMesh above, below;
+			mesh.Split(plane, workspace, above, below, false);
+			const auto area = [](const std::vector<Intersector::Vec3D>& points,
+				const std::vector<Intersector::Face>& triangles) {
+				double total(0);
+				for (const auto& face : triangles) {
+					Intersector::Vec3D ab, ac;
+					for (int i(0); i < 3; ++i) {
+						ab[i] = points[face[1]][i] - points[face[0]][i];
+						ac[i] = points[face[2]][i] - points[face[0]][i];
+					}
+					total += std::sqrt(std::pow(ab[1] * ac[2] - ab[2] * ac[1], 2) +
+						std::pow(ab[2] * ac[0] - ab[0] * ac[2], 2) + std::pow(ab[0] * ac[1] - ab[1] * ac[0], 2)) / 2;
+				}
+				return total;
+			};
+
+			THEN("the parts cover the grid between them") {
+				REQUIRE(area(above.vertices, above.faces) + area(below.vertices, below.faces) ==
+					Approx(area(vertices, faces)));
+			}
+			THEN("the edges of the parts along the cut are the intersection") {
+				const auto paths(mesh.Intersect(plane));
+				size_t points(0);
+				for (const auto& path : paths) {
+					points += path.points.size();
+				}
+				size_t onPlane(0);
+				for (const auto& vertex : below.vertices) {
+					onPlane += std::abs(vertex[2] - 0.1) < 1e-12;
+				}
+				REQUIRE(onPlane == points);
+			}
+		}
+	}
+}
+
+SCENARIO("A section moved through the mesh gives the same intersections") {
+
+	GIVEN("a wavy grid mesh and a section along a tilted normal") {
+		std::vector<Intersector::Vec3D> vertices;
+		std::vector<Intersector::Face> faces;
+		WavyGrid(60, 40, vertices, faces);
+
+		Intersector::Mesh mesh(vertices, faces);
+		const Intersector::Vec3D normal{ 0.01,0.02,1 };
+		Intersector::Mesh::Section section(mesh, normal);
+
+		WHEN("the plane moves up in small steps and then jumps back down") {
+			for (const double offset : { -0.3, -0.29, -0.25, 0.0, 0.01, 0.4, -0.6, -0.1 }) {
+				const auto plane = Intersector::Mesh::SlicePlane(normal, offset);
+				for (bool isClip : { false, true }) {
+					auto expected = isClip ? mesh.Clip(plane) : mesh.Intersect(plane);
+					auto result = isClip ? section.Clip(offset) : section.Intersect(offset);
+					REQUIRE(result.size() == expected.size());
+					for (size_t i(0); i < result.size(); ++i) {
+						REQUIRE(result[i].points == expected[i].points);
+						REQUIRE(result[i].isClosed == expected[i].isClosed);
+					}
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("Intersecting a mesh streamed from a mapped file") {
+
+	GIVEN("a wavy grid mesh written to a mesh file") {
+		std::vector<Intersector::Vec3D> vertices;
+		std::vector<Intersector::Face> faces;
+		WavyGrid(60, 40, vertices, faces);
+		// shuffle the faces so that each chunk touches vertices all over the mesh
+		for (size_t i(0); i < faces.size(); ++i) {
+			std::swap(faces[i], faces[(i * 7919) % faces.size()]);
+		}
+		const std::string path("MeshPlaneIntersectStreamTest.mesh");
+		MappedMeshFile<double, int>::Write(path, vertices, faces);
+
+		Intersector::Mesh mesh(vertices, faces);
+		Intersector::Plane plane;
+		plane.origin = { 0,0,0.1 };
+		plane.normal = { 0.01,0.02,1 };
+
+		WHEN("we intersect the file a few hundred faces at a time") {
+			auto expected = mesh.Intersect(plane);
+			std::vector<Intersector::Path3D> result;
+			{
+				MappedMeshFile<double, int> file(path);
+				REQUIRE(file.VertexCount() == vertices.size());
+				REQUIRE(file.FaceCount() == faces.size());
+				result = Intersector::Mesh::IntersectStream(file, plane, 300);
+			}
+			std::remove(path.c_str());
+
+			REQUIRE(expected.size() > 1);
+			REQUIRE(result.size() == expected.size());
+			for (size_t i(0); i < result.size(); ++i) {
+				REQUIRE(result[i].points == expected[i].points);
+				REQUIRE(result[i].isClosed == expected[i].isClosed);
+			}
+		}
+
+		WHEN("a face in the file has a vertex out of range") {
+			for (const int vertex : { static_cast<int>(vertices.size()), -1 }) {
+				faces[faces.size() / 2][1] = vertex;
+				MappedMeshFile<double, int>::Write(path, vertices, faces);
+				{
+					MappedMeshFile<double, int> file(path);
+					REQUIRE_THROWS_AS(Intersector::Mesh::IntersectStream(file, plane, 300),
+						std::runtime_error);
+				}
+				std::remove(path.c_str());
+			}
+		}
+	}
+}
+
+SCENARIO("A mesh mapped from a cache file gives the same intersections") {
+
+	GIVEN("a wavy grid mesh with everything built for it, written to a cache file") {
+		std::vector<Intersector::Vec3D> vertices;
+		std::vector<Intersector::Face> faces;
+		WavyGrid(60, 40, vertices, faces);
+		Intersector::Mesh mesh(vertices, faces);
+		Intersector::Mesh built(vertices, faces);
+		built.BuildTopology();
+		built.BuildVertexArrays();
+		built.BuildFaceHierarchy();
+		const std::string path("MeshPlaneIntersectCacheTest.cache");
+		const std::string barePath("MeshPlaneIntersectCacheTest.bare.cache");
+		MeshCacheFile<double, int>::Write(path, built);
+		MeshCacheFile<double, int>::Write(barePath, mesh);
+
+		WHEN("we intersect and clip the mapped mesh") {
+			std::vector<Intersector::Plane> planes(3);
+			planes[0].origin = { 0,0,0.1 };
+			planes[0].normal = { 0.01,0.02,1 };
+			planes[1].origin = { 30,20,0 };
+			planes[1].normal = { 1,0.3,0.2 };
+			planes[2].origin = { 0,0,-0.5 };
+			{
+				MeshCacheFile<double, int> file(path), bare(barePath);
+				REQUIRE_NOTHROW(file.Validate());
+				REQUIRE_NOTHROW(bare.Validate());
+				for (const auto& plane : planes) {
+					const auto expected(mesh.Intersect(plane));
+					const auto expectedClip(mesh.Clip(plane));
+					REQUIRE(!expected.empty());
+					for (const auto* cached : { &file.GetMesh(), &bare.GetMesh() }) {
+						const auto result(cached->Intersect(plane));
+						const auto clip(cached->Clip(plane));
+						REQUIRE(result.size() == expected.size());
+						for (size_t i(0); i < result.size(); ++i) {
+							REQUIRE(result[i].points == expected[i].points);
+							REQUIRE(result[i].isClosed == expected[i].isClosed);
+						}
+						REQUIRE(clip.size() == expectedClip.size());
+						for (size_t i(0); i < clip.size(); ++i) {
+							REQUIRE(clip[i].points == expectedClip[i].points);
+							REQUIRE(clip[i].isClosed == expectedClip[i].isClosed);
+						}
+					}
+				}
+			}
+			std::remove(path.c_str());
+			std::remove(barePath.c_str());
+		}
+
+		WHEN("the file isn't a cache file for these types, or is cut short") {
+			MappedMeshFile<double, int>::Write(barePath, vertices, faces);
+			REQUIRE_THROWS_AS((MeshCacheFile<double, int>(barePath)), std::runtime_error);
+			REQUIRE_THROWS_AS((MeshCacheFile<double, std::int64_t>(path)), std::runtime_error);
+			REQUIRE_THROWS_AS((MeshCacheFile<float, int>(path)), std::runtime_error);
+			{
+				std::ifstream in(path, std::ios::binary);
+				std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+				std::ofstream out(barePath, std::ios::binary);
+				out.write(bytes.data(), bytes.size() - 100);
+			}
+			REQUIRE_THROWS_AS((MeshCacheFile<double, int>(barePath)), std::runtime_error);
+			std::remove(path.c_str());
+			std::remove(barePath.c_str());
+		}
+
+		WHEN("a face, twin or hierarchy number in the file is out of range") {
+			std::string bytes;
+			{
+				std::ifstream in(path, std::ios::binary);
+				bytes.assign((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+			}
+			// the table of array offsets follows the magic and four 32 bit words
+			const auto corrupt = [&](const int iArray, const size_t byte, const int value) {
+				std::uint64_t offset;
+				std::memcpy(&offset, bytes.data() + 24 + 24 * iArray, sizeof(offset));
+				std::string corrupted(bytes);
+				std::memcpy(&corrupted[static_cast<size_t>(offset) + byte], &value, sizeof(value));
+				std::ofstream out(barePath, std::ios::binary);
+				out.write(corrupted.data(), corrupted.size());
+			};
+			// opening the file doesn't look through the arrays, so only Validate finds these
+			corrupt(1, 4, static_cast<int>(vertices.size()));
+			REQUIRE_NOTHROW((MeshCacheFile<double, int>(barePath)));
+			REQUIRE_THROWS_AS((MeshCacheFile<double, int>(barePath).Validate()), std::runtime_error);
+			corrupt(2, 0, static_cast<int>(faces.size() * 3));
+			REQUIRE_THROWS_AS((MeshCacheFile<double, int>(barePath).Validate()), std::runtime_error);
+			corrupt(11, 2 * sizeof(Intersector::Vec3D), -1);
+			REQUIRE_THROWS_AS((MeshCacheFile<double, int>(barePath).Validate()), std::runtime_error);
+			corrupt(12, 0, static_cast<int>(faces.size()));
+			REQUIRE_THROWS_AS((MeshCacheFile<double, int>(barePath).Validate()), std::runtime_error);
+			corrupt(1, 4, 0);
+			MeshCacheFile<double, int> valid(barePath);
+			REQUIRE_NOTHROW(valid.Validate());
+			REQUIRE(!valid.GetMesh().Intersect(Intersector::Plane()).empty());
+			std::remove(path.c_str());
+			std::remove(barePath.c_str());
+		}
+	}
+}
+
+SCENARIO("A mesh made from vectors sees what they hold at each query") {
+
+	GIVEN("a mesh made before its vectors are filled") {
+		std::vector<Intersector::Vec3D> vertices;
+		std::vector<Intersector::Face> faces;
+		Intersector::Mesh mesh(vertices, faces);
+		Intersector::Plane plane;
+		plane.origin = { 0,0,0.1 };
+		REQUIRE(mesh.Intersect(plane).empty());
+
+		WHEN("the vectors are filled, and then grown past their capacity") {
+			WavyGrid(60, 40, vertices, faces);
+			std::vector<Intersector::Vec3D> gridVertices(vertices);
+			std::vector<Intersector::Face> gridFaces(faces);
+			const auto filled(mesh.Intersect(plane));
+			for (int i(0); i < 3; ++i) {
+				vertices.push_back({ 100.0 + i, double(i == 2), i == 1 ? 1.0 : -1.0 });
+			}
+			const int first(static_cast<int>(vertices.size()) - 3);
+			faces.push_back({ first, first + 1, first + 2 });
+			vertices.shrink_to_fit();
+			faces.shrink_to_fit();
+			const auto grown(mesh.Clip(plane));
+
+			THEN("each query gives the paths of the mesh the vectors held then") {
+				const auto expected(Intersector::Mesh(gridVertices, gridFaces).Intersect(plane));
+				REQUIRE(!expected.empty());
+				REQUIRE(filled.size() == expected.size());
+				for (size_t i(0); i < filled.size(); ++i) {
+					REQUIRE(filled[i].points == expected[i].points);
+				}
+				const auto expectedGrown(Intersector::Mesh(vertices, faces).Clip(plane));
+				REQUIRE(grown.size() == expectedGrown.size());
+				REQUIRE(grown.size() > Intersector::Mesh(gridVertices, gridFaces).Clip(plane).size());
+				for (size_t i(0); i < grown.size(); ++i) {
+					REQUIRE(grown[i].points == expectedGrown[i].points);
+				}
+			}
+		}
+	}
+}
+
+// writes the mesh as a triangle soup in binary STL, and as indexed OBJ and PLY files
+static void WriteMeshFiles(const std::vector<Intersector::Vec3D>& vertices,
+	const std::vector<Intersector::Face>& faces, const std::string& name) {
+	std::ofstream stl(name + ".stl", std::ios::binary);
+	const std::uint32_t triangleCount(static_cast<std::uint32_t>(faces.size()));
+	stl << std::string(80, ' ');
+	stl.write(reinterpret_cast<const char*>(&triangleCount), 4);
+	for (const auto& face : faces) {
+		float record[12] = {};
+		for (int i(0); i < 9; ++i) {
+			record[3 + i] = static_cast<float>(vertices[face[i / 3]][i % 3]);
+		}
+		stl.write(reinterpret_cast<const char*>(record), sizeof(record));
+		stl.write("\0\0", 2);
+	}
+
+	std::ofstream obj(name + ".obj");
+	obj.precision(17);
+	obj << "# wavy grid\no grid\n";
+	for (const auto& vertex : vertices) {
+		obj << "v " << vertex[0] << " " << vertex[1] << " " << vertex[2] << "\n";
+	}
+	obj << "vt 0 0\n";
+	for (const auto& face : faces) {
+		obj << "f " << face[0] + 1 << "/1 " << face[1] + 1 << "/1 " << face[2] + 1 << "/1\n";
+	}
+
+	std::ofstream ply(name + ".ply", std::ios::binary);
+	ply << "ply\nformat binary_little_endian 1.0\ncomment wavy grid\nelement vertex " <<
+		vertices.size() << "\nproperty double x\nproperty double y\nproperty double z\n" <<
+		"property uchar red\nelement face " << faces.size() <<
+		"\nproperty list uchar int vertex_indices\nend_header\n";
+	for (const auto& vertex : vertices) {
+		ply.write(reinterpret_cast<const char*>(vertex.data()), sizeof(vertex));
+		ply.write("\x7f", 1);
+	}
+	for (const auto& face : faces) {
+		ply.write("\x03", 1);
+		ply.write(reinterpret_cast<const char*>(face.data()), sizeof(face));
+	}
+}
+
+SCENARIO("Loading and welding mesh files") {
+
+	GIVEN("a wavy grid mesh") {
+		std::vector<Intersector::Vec3D> vertices;
+		std::vector<Intersector::Face> faces;
+		// big enough for the binary records to be read on more than one thread
+		WavyGrid(120, 80, vertices, faces);
+		// the STL file holds floats, so keep to values they hold exactly
+		for (auto& vertex : vertices) {
+			vertex[2] = static_cast<float>(vertex[2]);
+		}
+
+		WHEN("we write it as STL, OBJ and PLY files and load each of them") {
+			const std::string name("MeshPlaneIntersectLoaderTest");
+			WriteMeshFiles(vertices, faces, name);
+			for (const auto& extension : { ".stl", ".obj", ".ply" }) {
+				std::vector<Intersector::Vec3D> loadedVertices;
+				std::vector<Intersector::Face> loadedFaces;
+				MeshLoader<double, int>::Load(name + extension, loadedVertices, loadedFaces, 0, 2);
+				std::remove((name + extension).c_str());
+
+				// the shared vertices are welded back together, though STL vertices are
+				// numbered in the order they are first used
+				std::vector<Intersector::Vec3D> corners, loadedCorners;
+				for (size_t i(0); i < faces.size(); ++i) {
+					for (int j(0); j < 3; ++j) {
+						corners.push_back(vertices[faces[i][j]]);
+						if (i < loadedFaces.size()) {
+							loadedCorners.push_back(loadedVertices[loadedFaces[i][j]]);
+						}
+					}
+				}
+				REQUIRE(loadedVertices.size() == vertices.size());
+				REQUIRE(loadedFaces.size() == faces.size());
+				REQUIRE(loadedCorners == corners);
+			}
+		}
+
+		WHEN("we weld points within a tolerance of each other") {
+			std::vector<Intersector::Vec3D> points(vertices);
+			points.push_back({ 1.0001, 0, static_cast<double>(static_cast<float>(std::sin(0.3))) });
+			points.push_back({ 100, 100, 100 });
+			std::vector<Intersector::Vec3D> welded;
+			std::vector<size_t> pointVertices;
+			MeshLoader<double, int>::WeldPoints(points, 0.001, welded, pointVertices);
+
+			THEN("only the points near others are merged") {
+				REQUIRE(welded.size() == vertices.size() + 1);
+				REQUIRE(pointVertices[vertices.size()] == 1);
+				REQUIRE(pointVertices[vertices.size() + 1] == vertices.size());
+			}
+		}
+	}
+}